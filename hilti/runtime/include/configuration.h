@@ -28,6 +28,40 @@ struct Configuration {
     /** Max. number of fibers cached for reuse. */
     unsigned int fiber_cache_size = 200;
 
+    /**
+     * Run functions that are guaranteed not to suspend directly on the
+     * caller's stack, without setting up a fiber. Currently, that applies to
+     * external entry points marked with `&no-fiber-if-frozen` when called
+     * with input that's already frozen.
+     */
+    bool fiber_direct_execution = true;
+
+    /**
+     * Amount of stack memory to keep resident for idle fibers that used more
+     * than that. Anything beyond is returned to the OS when trimming the
+     * fiber cache, while the stack stays mapped at its full size, so this
+     * doesn't limit how deep future payloads may go.
+     */
+    size_t fiber_stack_retain_size = static_cast<size_t>(64 * 1024);
+
+    /**
+     * Number of fiber completions between trims of the fiber cache. A trim
+     * releases stack memory beyond `fiber_stack_retain_size` from fibers
+     * that have stayed unused in the cache since the previous trim, and from
+     * the shared stack if it hasn't gone that deep since then. Zero disables
+     * trimming.
+     */
+    unsigned int fiber_cache_trim_interval = 1000;
+
+    /**
+     * Max. number of compiled regular expression objects cached for reuse.
+     * As their automata are built completely at compile time and don't grow
+     * while matching, this also bounds the memory the cache holds on to.
+     * Expressions still in use remain alive even if they are evicted from
+     * the cache.
+     */
+    unsigned int compiled_regexp_cache_size = 1000;
+
     /**
      * Minimum stack size that a fiber must have left for use at beginning of a
      * function's execution. This should leave enough headroom for (1) the
@@ -63,6 +97,32 @@ struct Configuration {
      **/
     bool enable_profiling = false;
 
+    /**
+     * When profiling, time only every n-th top-level execution of each
+     * profiled block of code, extrapolating totals from those. Counts and
+     * volumes are still recorded for all executions. Raising this reduces
+     * profiling overhead for long-running processes.
+     */
+    unsigned int profiling_sample_rate = 1;
+
+    /**
+     * Max. number of individual executions of profiled blocks to record for
+     * export as a trace. Zero disables recording; executions beyond the
+     * limit are dropped. Only executions that get timed are recorded.
+     */
+    size_t profiling_trace_events = 0;
+
+    /** If set, file to write profiling results to in JSON format at termination. */
+    std::optional<hilti::rt::filesystem::path> profiling_json_output;
+
+    /**
+     * If set, file to write a trace of profiled executions to in Chrome's
+     * `trace_event` format at termination, for viewing with Perfetto or
+     * `chrome://tracing`. If `profiling_trace_events` is zero, this records up
+     * to one million executions.
+     */
+    std::optional<hilti::rt::filesystem::path> profiling_trace_output;
+
     /** Colon-separated list of debug streams to enable. Default comes from HILTI_DEBUG. */
     std::string debug_streams;
 
@@ -87,6 +147,13 @@ inline const Configuration& unsafeGet() {
     return *detail::__configuration;
 }
 
+/**
+ * Returns the stream that `hilti::print()` writes to. That's the current
+ * context's stream if it sets one, and `Configuration::cout` otherwise.
+ * Returns null if printing is silenced.
+ */
+extern std::ostream* printStream();
+
 } // namespace detail
 
 /**
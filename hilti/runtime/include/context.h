@@ -3,12 +3,14 @@
 #pragma once
 
 #include <cassert>
+#include <iosfwd>
 #include <memory>
 #include <utility>
 #include <vector>
 
 #include <hilti/rt/fiber.h>
 #include <hilti/rt/threading.h>
+#include <hilti/rt/types/stream-pool.h>
 
 namespace hilti::rt {
 
@@ -38,6 +40,12 @@ struct Context {
      */
     vthread::ID vid;
 
+    /**
+     * Cache of memory for stream chunks. Declared early so that it outlives
+     * any state below that may still release chunks on destruction.
+     */
+    stream::detail::ChunkPool stream_pool;
+
     /**
      * Current resumable if we're inside a fiber so that yielding is
      * supported. Ownership remains with original caller.
@@ -66,6 +74,12 @@ struct Context {
      * `resumable` is not set.
      */
     const char* location = nullptr;
+
+    /**
+     * Output stream for `hilti::print()` while executing inside this
+     * context. If set, this overrides `Configuration::cout`.
+     */
+    std::ostream* cout = nullptr;
 };
 
 namespace context {
@@ -175,5 +189,21 @@ Resumable execute(Function f, Params&&... params) {
     return r;
 }
 
+/**
+ * Executes a function directly on the caller's stack, bypassing the fiber
+ * machinery. This avoids the cost of setting up a fiber, but is only safe if
+ * the function is known to not suspend: any attempt to yield will raise a
+ * `RuntimeError`.
+ *
+ * @param f function to execute
+ * @param params arguments to pass into function
+ * @return resumable object that has already completed with the function's result
+ */
+template<typename Function, typename... Params>
+Resumable executeDirectly(Function f, Params&&... params) {
+    auto _ = detail::ResumableSetter(nullptr);
+    return Resumable::fromResult(f(std::forward<Params>(params)...));
+}
+
 } // namespace context
 } // namespace hilti::rt
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string_view>
 
 #include <hilti/rt/filesystem.h>
@@ -12,7 +13,10 @@
 
 namespace hilti::rt::detail {
 
-/** Logger for runtime debug messages. */
+/**
+ * Logger for runtime debug messages. The set of enabled streams must not
+ * change once threads are running; everything else is thread-safe.
+ */
 class DebugLogger {
 public:
     DebugLogger(hilti::rt::filesystem::path output);
@@ -24,6 +28,7 @@ public:
 
     void indent(std::string_view stream) {
         if ( auto s = _streams.find(stream); s != _streams.end() ) {
+            std::scoped_lock lock(_mutex);
             auto& indent = s->second;
             indent += 1;
         }
@@ -31,6 +36,7 @@ public:
 
     void dedent(std::string_view stream) {
         if ( auto s = _streams.find(stream); s != _streams.end() ) {
+            std::scoped_lock lock(_mutex);
             auto& indent = s->second;
             if ( indent > 0 )
                 indent -= 1;
@@ -42,6 +48,7 @@ private:
     std::ostream* _output = nullptr;
     std::unique_ptr<std::ofstream> _output_file;
     std::map<std::string_view, integer::safe<uint64_t>> _streams;
+    std::mutex _mutex; // serializes output and indentation changes across threads
 };
 
 } // namespace hilti::rt::detail
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <optional>
 #include <ostream>
 #include <stdexcept>
@@ -17,6 +19,35 @@ namespace hilti::rt {
 
 class String;
 
+namespace exception {
+
+/**
+ * Raw ingredients of an exception's description, for rendering it only once
+ * somebody asks for it. Instead of formatting its message at construction
+ * time, an exception can record an error code along with the unformatted
+ * arguments, plus a function that turns them into text on first access
+ * through `what()` or `description()`. That keeps throwing cheap for errors
+ * that get caught and discarded right away, such as during backtracking or
+ * error recovery.
+ *
+ * The strings referenced by `message` and `location` are not copied, so
+ * they must remain valid for the lifetime of the exception. Normally they
+ * point to string literals.
+ */
+struct Deferred {
+    /** Function rendering the description from the raw arguments. */
+    using Renderer = std::string (*)(const Deferred& d);
+
+    Renderer render = nullptr;         /**< renderer producing the description */
+    int code = 0;                      /**< error code for the renderer to dispatch on */
+    std::string_view message;          /**< static message for the renderer */
+    std::string_view location;         /**< static location of the operation that failed */
+    std::array<uint64_t, 2> values{};  /**< numerical arguments */
+    std::array<std::string, 2> data{}; /**< string arguments, owned by the exception */
+};
+
+} // namespace exception
+
 /**
  * HILTI's base exception type. All HILTI-side runtime exceptions are derived
  * from this. Instantiate specialized derived classes, not the base class.
@@ -48,7 +79,9 @@ public:
         : std::runtime_error(other),
           _description(other._description),
           _location(other._location),
-          _backtrace(other._backtrace) {}
+          _backtrace(other._backtrace),
+          _deferred(other._deferred),
+          _what(other._what) {}
 
     Exception(Exception&&) noexcept = default;
     Exception& operator=(const Exception& other) = default;
@@ -61,10 +94,22 @@ public:
     ~Exception() override;
 
     /** Returns the message associated with the exception. */
-    std::string_view description() const { return _description; }
+    std::string_view description() const {
+        if ( _deferred )
+            _render();
+
+        return _description;
+    }
 
     /** Returns the location associated with the exception. */
-    std::string_view location() const { return _location; }
+    std::string_view location() const { return _deferred ? _deferred->location : _location; }
+
+    /**
+     * Returns the message associated with the exception, including its
+     * location. For exceptions with a deferred description, this renders
+     * it on first access.
+     */
+    const char* what() const noexcept override;
 
     /**
      * Returns a stack backtrace captured at the time the exception was
@@ -82,13 +127,19 @@ protected:
 
     Exception(Internal, const char* type, std::string_view desc);
     Exception(Internal, const char* type, std::string_view desc, std::string_view location);
+    Exception(Internal, const char* type, exception::Deferred deferred);
 
 private:
     Exception(Internal, const char* type, std::string_view what, std::string_view desc, std::string_view location);
 
-    std::string _description;
-    std::string _location;
-    std::optional<Backtrace> _backtrace; // null if unavailable.
+    void _init(const char* type);
+    void _render() const;
+
+    mutable std::string _description;             // rendered on demand if deferred
+    std::string _location;                        // unused if deferred
+    std::optional<Backtrace> _backtrace;          // null if unavailable.
+    std::optional<exception::Deferred> _deferred; // set if description is rendered on demand
+    mutable std::string _what;                    // rendered `what()` if deferred
 };
 
 inline std::ostream& operator<<(std::ostream& stream, const Exception& e) { return stream << e.what(); }
@@ -98,6 +149,7 @@ inline std::ostream& operator<<(std::ostream& stream, const Exception& e) { retu
     public:                                                                                                            \
         name(std::string_view desc) : base(Internal(), #name, desc) {}                                                 \
         name(std::string_view desc, std::string_view location) : base(Internal(), #name, desc, location) {}            \
+        name(::hilti::rt::exception::Deferred deferred) : base(Internal(), #name, std::move(deferred)) {}              \
         virtual ~name(); /* required to create vtable, see hilti::rt::Exception */                                     \
                                                                                                                        \
         name(const name&) = default;                                                                                   \
@@ -115,6 +167,7 @@ inline std::ostream& operator<<(std::ostream& stream, const Exception& e) { retu
     public:                                                                                                            \
         name(std::string_view desc) : base(Internal(), #name, desc) {}                                                 \
         name(std::string_view desc, std::string_view location) : base(Internal(), #name, desc, location) {}            \
+        name(::hilti::rt::exception::Deferred deferred) : base(Internal(), #name, std::move(deferred)) {}              \
         virtual ~name(); /* required to create vtable, see hilti::rt::Exception */                                     \
                                                                                                                        \
     protected:                                                                                                         \
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <csetjmp>
 #include <exception>
 #include <memory>
@@ -67,6 +68,24 @@ struct FiberContext {
 
     /** Cache of previously used fibers available for reuse. */
     std::vector<std::unique_ptr<Fiber>> cache;
+
+    /**
+     * Smallest size of the cache since it was last trimmed. Fibers at
+     * positions below this have stayed idle since then.
+     */
+    size_t cache_low_water = 0;
+
+    /** Number of fibers finished since the cache was last trimmed. */
+    uint64_t completions_since_trim = 0;
+
+    /**
+     * Highest usage of the shared stack observed since its memory was last
+     * released.
+     */
+    size_t shared_stack_high_water = 0;
+
+    /** Highest usage of the shared stack observed since the cache was last trimmed. */
+    size_t shared_stack_recent_high_water = 0;
 };
 
 /**
@@ -109,6 +128,19 @@ struct StackBuffer {
     /** Returns an approximate size of stack space left for a currently executing fiber. */
     size_t liveRemainingSize() const;
 
+    /**
+     * Returns an approximate size of stack space currently in use by a
+     * currently executing fiber.
+     */
+    size_t liveUsedSize() const;
+
+    /**
+     * Returns memory of the stack region below the fiber's active region
+     * to the OS, leaving the uppermost `retain` bytes alone. The fiber must
+     * not be currently executing.
+     */
+    void releaseUnused(size_t retain) const;
+
     /** Copies the fiber's stack out into an internally allocated buffer. */
     void save();
 
@@ -252,6 +284,15 @@ private:
     void _yield(const char* tag);
     void _activate(const char* tag);
 
+    /** Records an observation of the fiber's current stack usage. */
+    void _recordStackUsage(size_t size);
+
+    /**
+     * Returns memory of stacks that have stayed idle since the last trim,
+     * yet were touched during past usage peaks, to the OS.
+     */
+    static void _trimCache(FiberContext* context);
+
     /** Code to run just before we switch to a fiber. */
     static void _startSwitchFiber(const char* tag, detail::Fiber* to);
 
@@ -276,6 +317,9 @@ private:
     /** Buffer for the fiber's stack when swapped out. */
     StackBuffer _stack_buffer;
 
+    /** Highest stack usage observed since the stack's memory was last released. */
+    size_t _stack_high_water = 0;
+
     /** Current location for user-visible diagnostic messages; null if not set. */
     const char* _location = nullptr;
 
@@ -297,14 +341,13 @@ private:
     } _asan;
 #endif
 
-    // TODO: Usage of these isn't thread-safe. Should become "atomic" and
-    // move into global state.
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _total_fibers;
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _current_fibers;
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _cached_fibers;
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _max_fibers;
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _max_stack_size;
-    HILTI_JIT_IMPORT_OR_INLINE static uint64_t _initialized; // number of trampolines run
+    // Statistics across all threads.
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _total_fibers;
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _current_fibers;
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _cached_fibers;
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _max_fibers;
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _max_stack_size;
+    HILTI_JIT_IMPORT_OR_INLINE static std::atomic<uint64_t> _initialized; // number of trampolines run
 };
 
 std::ostream& operator<<(std::ostream& out, const Fiber& fiber);
@@ -348,6 +391,21 @@ public:
             }
     }
 
+    /**
+     * Creates an instance representing a function that has already run to
+     * completion without a fiber, such as through
+     * `context::executeDirectly()`. The instance is done right away and
+     * returns the given result.
+     *
+     * @param result the function's result
+     */
+    static Resumable fromResult(hilti::rt::any result) {
+        Resumable r;
+        r._done = true;
+        r._result = std::move(result);
+        return r;
+    }
+
     /** Starts execution of the function. This must be called only once. */
     void run();
 
@@ -3,17 +3,20 @@
 #pragma once
 #include <sys/resource.h>
 
+#include <atomic>
 #include <clocale> // IWYU pragma: keep
+#include <list>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <hilti/rt/context.h>
 #include <hilti/rt/debug-logger.h>
 #include <hilti/rt/init.h>
-#include <hilti/rt/profiler-state.h>
 
 // We collect all (or most) of the runtime's global state centrally. That's
 // 1st good to see what we have (global state should be minimal) and 2nd
@@ -21,7 +24,10 @@
 // accessing any of this state is in charge of ensuring thread-safety itself.
 // These globals are generally initialized through hilti::rt::init();
 //
-// TODO(robin): Accesses to global state are *not* completely thread-safe yet.
+// Once the runtime has been initialized, state that's modified during
+// execution is either atomic or protected by a lock, so that multiple
+// threads may execute HILTI code concurrently as long as each uses its own
+// `Context`. Everything else must be treated as read-only at that point.
 
 namespace hilti::rt {
 struct Configuration;
@@ -57,14 +63,11 @@ struct GlobalState {
     bool profiling_enabled = false;
 
     /** If not zero, `Configuration::abort_on_exception` is disabled. */
-    int disable_abort_on_exceptions = 0;
+    std::atomic<int> disable_abort_on_exceptions = 0;
 
     /** Resource usage at library initialization time. */
     ResourceUsage resource_usage_init;
 
-    /** Profiler's global measurements. */
-    std::unordered_map<std::string, profiler::detail::MeasurementState> profilers;
-
     /** Debug logger recording runtime diagnostics. */
     std::unique_ptr<hilti::rt::detail::DebugLogger> debug_logger;
 
@@ -80,8 +83,40 @@ struct GlobalState {
      */
     std::vector<hilti::rt::detail::HiltiModule> hilti_modules;
 
-    /** Cache of already compiled regular expressions. */
-    std::unordered_map<std::string, std::shared_ptr<regexp::detail::CompiledRegExp>> regexp_cache;
+    /**
+     * Cache of compiled regular expression objects, shared by all threads.
+     * This is bounded by `Configuration::compiled_regexp_cache_size`,
+     * evicting entries as necessary. Lookups only need a shared lock: instead
+     * of reordering entries on each hit, they just mark the entry as
+     * referenced, and eviction then gives referenced entries a second chance
+     * (i.e., the CLOCK approximation of LRU).
+     */
+    struct CompiledRegExpCache {
+        /** Entry inside the cache. */
+        struct Entry {
+            std::string key; /**< patterns and flags the entry is indexed by */
+            std::shared_ptr<const regexp::detail::CompiledRegExp> regexp;
+            std::atomic<bool> referenced = false; /**< set on each hit, cleared when passed over by eviction */
+        };
+
+        /** Cached regular expressions, with eviction candidates at the back. */
+        std::list<Entry> lru;
+
+        /** Index into `lru` by patterns and flags. */
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+
+        /** Lock protecting `lru` and `entries`; taken shared for lookups. */
+        std::shared_mutex mutex;
+
+        /** Removes all entries. */
+        void clear() {
+            entries.clear();
+            lru.clear();
+        }
+    };
+
+    /** Cache of compiled regular expressions. */
+    CompiledRegExpCache compiled_regexp_cache;
 
     /** Cached C locale for use with C library functions. */
     std::optional<runtime_locale_t> c_locale;
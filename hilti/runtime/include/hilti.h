@@ -21,10 +21,11 @@ struct TypeInfo;
 /** Corresponds to `hilti::print`. */
 template<typename T>
 void print(const T& t, const hilti::rt::TypeInfo* /* ti */, bool newline = true) {
-    if ( ! configuration::get().cout )
+    auto* out = configuration::detail::printStream();
+    if ( ! out )
         return;
 
-    auto& cout = configuration::get().cout->get();
+    auto& cout = *out;
 
     cout << hilti::rt::to_string_for_print(t);
 
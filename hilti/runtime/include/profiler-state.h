@@ -21,7 +21,7 @@ namespace hilti::rt::profiler {
  */
 struct Measurement {
     uint64_t count = 0;                   /**< Number of measurements taken. */
-    uint64_t time = 0;                    /**< Measured time in system-specific high resolution clock. */
+    uint64_t time = 0;                    /**< Measured time; in nanoseconds unless marked otherwise. */
     hilti::rt::Optional<uint64_t> volume; /**< Measured absolute volume in bytes, if applicable */
 
     Measurement& operator+=(const Measurement& m) {
@@ -56,14 +56,18 @@ struct Measurement {
 
 inline std::string to_string(const Measurement&, detail::adl::tag /*unused*/) { return "<profiler measurement>"; }
 
-namespace detail {
-
-// Structure for storing global state.
-struct MeasurementState {
-    Measurement m = {};
-    uint64_t instances = 0;
+/**
+ * Distribution of the execution times of a profiled block of code, as
+ * recorded across its (sampled) top-level executions. Percentiles are
+ * approximations with a relative error of at most 1/16.
+ */
+struct Latencies {
+    uint64_t samples = 0; /**< Number of executions timed. */
+    uint64_t p50 = 0;     /**< Median execution time in nanoseconds. */
+    uint64_t p99 = 0;     /**< 99th percentile of execution times in nanoseconds. */
+    uint64_t max = 0;     /**< Maximum execution time in nanoseconds. */
 };
 
-} // namespace detail
+inline std::string to_string(const Latencies&, detail::adl::tag /*unused*/) { return "<profiler latencies>"; }
 
 } // namespace hilti::rt::profiler
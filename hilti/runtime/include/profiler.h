@@ -4,7 +4,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <iosfwd>
+#include <limits>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <hilti/rt/configuration.h>
 #include <hilti/rt/global-state.h>
@@ -18,6 +23,27 @@ class Profiler;
 
 namespace profiler {
 
+/**
+ * Index identifying a block of code to profile. Slots are allocated once per
+ * name through `slot()`, typically at initialization time, so that
+ * recording measurements doesn't need to look up names.
+ */
+using Slot = uint32_t;
+
+/** Value of a `Slot` not referring to any block of code. */
+inline constexpr Slot NoSlot = std::numeric_limits<Slot>::max();
+
+/**
+ * Returns the slot for a block of code, allocating a new one on first use of
+ * a name. Slots remain valid for the lifetime of the process, including
+ * across runtime re-initializations.
+ *
+ * @param name descriptive, unique name of the block of code to profile
+ * @throws RuntimeError if the maximum number of slots has been exhausted
+ */
+extern Slot slot(std::string_view name);
+
+hilti::rt::Optional<Profiler> start(Slot slot, hilti::rt::Optional<uint64_t> volume = Null());
 hilti::rt::Optional<Profiler> start(std::string_view name, hilti::rt::Optional<uint64_t> volume = Null());
 void stop(hilti::rt::Optional<Profiler>& p, hilti::rt::Optional<uint64_t> volume = Null());
 
@@ -31,6 +57,10 @@ extern void init();
 // profiling report.
 extern void done();
 
+// Internal function incrementing a counter, called by `count()` when
+// profiling is enabled.
+extern void count(Slot slot, uint64_t n);
+
 } // namespace detail
 } // namespace profiler
 
@@ -38,8 +68,13 @@ extern void done();
  * Class representing one block of code to profile. The constructor records a
  * first measurement, and the destructor records a second. The delta between
  * the two measurements is then added to a global total kept for respective
- * block of code. Blocks are identified through descriptive names, which will
- * be shows as part of the final report.
+ * block of code. Blocks are identified through slots allocated for their
+ * descriptive names, which will be shows as part of the final report.
+ *
+ * Execution times are taken from the CPU's timestamp counter where
+ * available, and converted into nanoseconds only when reported. With
+ * `Configuration::profiling_sample_rate` set, only a subset of executions
+ * gets timed.
  *
  * Profilers can't be instantiated directly; use the `start()` and `stop()` API instead.
  */
@@ -53,22 +88,39 @@ public:
     Profiler() = default;
 
     Profiler(const Profiler& other) = delete;
-    Profiler(Profiler&& other) = default;
+    Profiler(Profiler&& other) noexcept
+        : _slot(std::exchange(other._slot, profiler::NoSlot)), _start(std::move(other._start)), _timed(other._timed) {}
 
     /** Destructor concluding any pending measurement. */
-    ~Profiler() { record(snapshot()); }
+    ~Profiler() {
+        if ( *this )
+            _finish(Null());
+    }
 
     Profiler& operator=(const Profiler& other) = delete;
-    Profiler& operator=(Profiler&& other) = default;
+
+    Profiler& operator=(Profiler&& other) noexcept {
+        if ( this != &other ) {
+            if ( *this )
+                _finish(Null());
+
+            _slot = std::exchange(other._slot, profiler::NoSlot);
+            _start = std::move(other._start);
+            _timed = other._timed;
+        }
+
+        return *this;
+    }
 
     /** Take final measurement and record the delta between first and final. */
     void record(const profiler::Measurement& end);
 
     /** Returns true if the profiler is currently taking an active measurement. */
-    operator bool() const { return ! _name.empty(); }
+    operator bool() const { return _slot != profiler::NoSlot; }
 
     /**
-     * Take and return a single measurement.
+     * Take and return a single measurement. The measurement's time is
+     * expressed in raw clock ticks.
      *
      * @param volume optional current absolute volume to record with the measurement
      */
@@ -79,21 +131,31 @@ protected:
      * Constructor starting a new measurement. Don't call directly, use
      * `profiler::start()` instead.
      *
-     * @param name descriptive, unique name of the block of code to profile
+     * @param slot slot of the block of code to profile
      * @param volume optional initial absolute volume to record with the measurement
      */
-    Profiler(std::string_view name, hilti::rt::Optional<uint64_t> volume) : _name(name), _start(snapshot(volume)) {
-        _register();
+    Profiler(profiler::Slot slot, hilti::rt::Optional<uint64_t> volume) : _slot(slot), _timed(_register()) {
+        if ( _timed )
+            _start = snapshot(volume);
+        else
+            _start.volume = std::move(volume);
     }
 
 private:
-    friend hilti::rt::Optional<Profiler> profiler::start(std::string_view name, hilti::rt::Optional<uint64_t> volume);
-    friend void profiler::detail::done();
+    friend hilti::rt::Optional<Profiler> profiler::start(profiler::Slot slot,
+                                                         hilti::rt::Optional<uint64_t> volume);
+    friend void profiler::stop(hilti::rt::Optional<Profiler>& p, hilti::rt::Optional<uint64_t> volume);
+
+    // Records the start of a measurement with the slot, returning true if
+    // this execution is to be timed.
+    bool _register() const;
 
-    void _register() const;
+    // Takes the final measurement, reading the clock only if needed.
+    void _finish(hilti::rt::Optional<uint64_t> volume);
 
-    std::string _name;            // Name of block to profile; empty is not active.
-    profiler::Measurement _start; // Initial measurement at construction time.
+    profiler::Slot _slot = profiler::NoSlot; // Slot of block to profile; `NoSlot` if not active.
+    profiler::Measurement _start;            // Initial measurement at construction time.
+    bool _timed = false;                     // True if measurement includes execution time.
 };
 
 namespace profiler {
@@ -102,13 +164,29 @@ namespace profiler {
  * until either `profiler::stop()` is called with it, or until the profiler
  * instances goes out of scope, whatever comes first.
  *
+ * @param slot slot of the block of code to profile, as returned by `slot()`
+ * @param volume optional initial absolute volume to record with the measurement
+ * @return profiler instance representing the active measurement
+ */
+inline hilti::rt::Optional<Profiler> start(Slot slot, hilti::rt::Optional<uint64_t> volume) {
+    if ( ::hilti::rt::detail::unsafeGlobalState()->profiling_enabled && slot != NoSlot )
+        return Profiler(slot, std::move(volume));
+    else
+        return {};
+}
+
+/**
+ * Start profiling of a code block identified by name. This needs to look up
+ * the name's slot first; prefer passing a slot allocated upfront for code
+ * that executes frequently.
+ *
  * @param name descriptive, unique name of the block of code to profile.
  * @param volume optional initial absolute volume to record with the measurement
  * @return profiler instance representing the active measurement
  */
 inline hilti::rt::Optional<Profiler> start(std::string_view name, hilti::rt::Optional<uint64_t> volume) {
     if ( ::hilti::rt::detail::unsafeGlobalState()->profiling_enabled )
-        return Profiler(name, volume);
+        return start(slot(name), std::move(volume));
     else
         return {};
 }
@@ -121,8 +199,33 @@ inline hilti::rt::Optional<Profiler> start(std::string_view name, hilti::rt::Opt
  * @param volume optional absolute volume to record with the final measurement
  */
 inline void stop(hilti::rt::Optional<Profiler>& p, hilti::rt::Optional<uint64_t> volume) {
-    if ( p )
-        p->record(Profiler::snapshot(volume));
+    if ( p && *p )
+        p->_finish(std::move(volume));
+}
+
+/**
+ * Increments an event counter. Counters are reported alongside the
+ * profiled code blocks, with just their count set. This is a no-op if
+ * profiling isn't enabled.
+ *
+ * @param slot slot of the counter, as returned by `slot()`
+ * @param n amount to increment the counter by
+ */
+inline void count(Slot slot, uint64_t n = 1) {
+    if ( ::hilti::rt::detail::unsafeGlobalState()->profiling_enabled )
+        detail::count(slot, n);
+}
+
+/**
+ * Increments a named event counter. This is a no-op if profiling isn't
+ * enabled.
+ *
+ * @param name descriptive, unique name of the counter
+ * @param n amount to increment the counter by
+ */
+inline void count(std::string_view name, uint64_t n = 1) {
+    if ( ::hilti::rt::detail::unsafeGlobalState()->profiling_enabled )
+        detail::count(slot(name), n);
 }
 
 /**
@@ -134,6 +237,76 @@ inline void stop(hilti::rt::Optional<Profiler>& p, hilti::rt::Optional<uint64_t>
  */
 hilti::rt::Optional<Measurement> get(const std::string& name);
 
+/**
+ * Retrieves the distribution of execution times for a code block by name,
+ * if known.
+ *
+ * @param name of the block of code to return data for
+ * @return latencies, or unset if no data is available
+ */
+hilti::rt::Optional<Latencies> latencies(const std::string& name);
+
+/** Aggregate measurements for one profiled block of code. */
+struct Summary {
+    std::string name;        /**< Name of the block. */
+    Measurement measurement; /**< Totals across all executions. */
+    Latencies latencies;     /**< Distribution of execution times. */
+};
+
+/** A single timed execution of a profiled block of code. */
+struct Span {
+    std::string_view name; /**< Name of the block; remains valid for the lifetime of the process. */
+    uint64_t thread;       /**< Small integer identifying the thread that executed the block. */
+    uint64_t start;        /**< Start time in nanoseconds since the snapshot's period began. */
+    uint64_t duration;     /**< Execution time in nanoseconds. */
+};
+
+/** Profiling data collected over a period of time. */
+struct Snapshot {
+    uint64_t time = 0;           /**< Length of the period in nanoseconds. */
+    std::vector<Summary> blocks; /**< All blocks executed or counted during the period, sorted by name. */
+    std::vector<Span> spans;     /**< Executions recorded during the period, if enabled. */
+    uint64_t dropped_spans = 0;  /**< Number of executions not recorded because the limit was reached. */
+};
+
+/**
+ * Returns all profiling data collected since profiling started, or since
+ * the last `reset()`. Long-running processes can use this to retrieve
+ * results periodically instead of waiting for the final report at
+ * termination.
+ */
+extern Snapshot snapshot();
+
+/**
+ * Clears all profiling data collected so far, starting a new period.
+ * Measurements still in progress will be recorded with the new period once
+ * they finish. Recorded executions may be lost if other threads are running
+ * profiled code concurrently.
+ */
+extern void reset();
+
+/**
+ * Writes profiling data in JSON format. The output is an object with the
+ * period's length as `time` and a list `blocks` with one object per block,
+ * carrying its `count`, `time`, `volume`, and latency percentiles. All times
+ * are in nanoseconds.
+ *
+ * @param out stream to write to
+ * @param snapshot profiling data to write
+ */
+extern void exportJSON(std::ostream& out, const Snapshot& snapshot);
+
+/**
+ * Writes recorded executions in Chrome's `trace_event` format, as
+ * understood by Perfetto and `chrome://tracing`. Each execution becomes a
+ * complete event; event counters become counter events at the end of the
+ * period.
+ *
+ * @param out stream to write to
+ * @param snapshot profiling data to write
+ */
+extern void exportChromeTrace(std::ostream& out, const Snapshot& snapshot);
+
 /** Produce end-of-process summary profiling report. */
 extern void report();
 
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include <bit>
 #include <cinttypes>
+#include <cstring>
 #include <limits>
 #include <string>
 #include <utility>
@@ -80,6 +82,23 @@ inline void pack(D x, uint8_t* dst, std::initializer_list<int> bytes) {
     }
 }
 
+// Reverses the byte order of an integer value. Compilers turn this into a
+// single `bswap` instruction.
+template<typename T>
+constexpr T byteswap(T x) {
+    using U = std::make_unsigned_t<T>;
+
+    auto u = static_cast<U>(x);
+    U r = 0;
+
+    for ( size_t i = 0; i < sizeof(T); ++i ) {
+        r = static_cast<U>((r << 8U) | (u & 0xffU));
+        u = static_cast<U>(u >> 8U);
+    }
+
+    return static_cast<T>(r);
+}
+
 template<typename T, typename D>
 inline Result<Tuple<integer::safe<T>, D>> unpack(D b, const uint8_t* dst, std::initializer_list<int> bytes) {
     T x = 0;
@@ -212,6 +231,53 @@ inline Result<Tuple<integer::safe<T>, D>> unpack(D b, ByteOrder fmt) {
     cannot_be_reached();
 }
 
+/**
+ * Unpacks an integer from the beginning of a stream view, advancing the view
+ * in place past the consumed bytes. If the bytes are available contiguously
+ * inside a single chunk, this reads them directly from there; otherwise it
+ * falls back to `unpack()`. This is a fast path for generated code that
+ * avoids creating the intermediary result tuple.
+ *
+ * @param b stream view to unpack from; will be advanced on success
+ * @param fmt byte order to use
+ * @return the unpacked value
+ * @throws the same exception as dereferencing the result of `unpack()` if
+ * unpacking fails
+ */
+template<typename T, typename D>
+inline integer::safe<T> unpackAndAdvance(D& b, ByteOrder fmt) {
+    constexpr bool host_is_little = (std::endian::native == std::endian::little);
+
+    bool little = false;
+    bool known = true;
+
+    switch ( fmt.value() ) {
+        case ByteOrder::Big:
+        case ByteOrder::Network: little = false; break;
+        case ByteOrder::Little: little = true; break;
+        case ByteOrder::Host: little = host_is_little; break;
+        default: known = false; break;
+    }
+
+    if ( known ) {
+        if ( const auto* raw = b.contiguousData(sizeof(T)) ) [[likely]] {
+            T x;
+            ::memcpy(&x, raw, sizeof(T));
+
+            if ( little != host_is_little )
+                x = detail::byteswap(x);
+
+            b.advanceInPlace(sizeof(T));
+            return x;
+        }
+    }
+
+    // Slow path: data straddles chunks, or not enough available.
+    auto x = unpack<T>(b, fmt).valueOrThrow();
+    b = std::move(tuple::get<1>(x));
+    return tuple::get<0>(x);
+}
+
 /**
  * Converts a 64-bit value from host-order to network order.
  *
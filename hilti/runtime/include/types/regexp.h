@@ -2,8 +2,12 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -176,6 +180,12 @@ namespace detail {
 // each unique set of patterns once into an instance of this class, which we
 // then retain inside a global cache for later reuse when seeing the same set
 // of patterns again.
+//
+// Instances are shared across threads and remain immutable once constructed;
+// all per-match state lives in `MatchState`. To that end, we have JRX build
+// the complete DFA upfront rather than lazily while matching, so that
+// matching never modifies the automaton and all threads can use the same one
+// without locking.
 class CompiledRegExp {
 public:
     CompiledRegExp(const regexp::Patterns& patterns, regexp::Flags flags);
@@ -191,6 +201,17 @@ public:
         return _jrx.get();
     }
 
+    // Returns the number of groups of the compiled patterns, including the
+    // one for the full match.
+    auto numGroups() const { return _num_groups; }
+
+    // Returns the JRX flags the patterns have been compiled with.
+    auto cflags() const { return _cflags; }
+
+    // Returns the offset of the first position inside `data` where a match
+    // may start, or `len` if there's none. See `RegExp::findCandidate()`.
+    size_t findCandidate(const char* data, size_t len) const;
+
 private:
     friend class rt::RegExp;
     friend class regexp::MatchState;
@@ -199,12 +220,28 @@ private:
         void operator()(jrx_regex_t* j);
     };
 
-    void _newJrx();
-    void _compileOne(regexp::Pattern pattern);
+    // Summary of how matches may begin, derived from the compiled automaton.
+    struct Prefilter {
+        std::array<bool, 256> first_bytes{}; // bytes that a match may begin with
+        std::string prefix;                  // literal prefix that every match begins with
+        bool enabled = false;                // false if a match may begin with any byte
+    };
+
+    // Compiles the patterns into the automaton.
+    void _compile();
+
+    void _computePrefilter() const;
+    int16_t _probe(std::string_view data) const;
 
     regexp::Flags _flags{};
     regexp::Patterns _patterns;
+    int _num_groups = 0;
+    int _cflags = 0;
     std::unique_ptr<jrx_regex_t, RegFree> _jrx;
+
+    // Computed on first use only, as only searches benefit from it.
+    mutable std::once_flag _prefilter_once;
+    mutable Prefilter _prefilter;
 };
 
 } // namespace detail
@@ -287,6 +324,21 @@ public:
      */
     Tuple<int32_t, Bytes> find(const Bytes& data) const;
 
+    /**
+     * Returns the offset of the first position inside a chunk of data where
+     * a match of the expression may start. This is derived from the bytes
+     * that any match must begin with, and lets searches skip quickly over
+     * data that cannot start a match. A returned position isn't guaranteed
+     * to match, but no match starts any earlier. Positions close to the end
+     * of the data may be returned if a match could begin there once more
+     * data arrives.
+     *
+     * @param data pointer to data to search
+     * @param len number of bytes to search
+     * @return offset of the first candidate position, or *len* if there's none
+     */
+    size_t findCandidate(const char* data, size_t len) const { return _re->findCandidate(data, len); }
+
     /**
      * Returns matching state initializes for incremental token matching. For
      * token matching the regular expression will be considered implicitly
@@ -294,7 +346,10 @@ public:
      */
     regexp::MatchState tokenMatcher() const;
 
-    /** Accessor to underlying JRX state. Intended for internal use and testing. */
+    /**
+     * Accessor to underlying JRX state as used by the current execution
+     * context. Intended for internal use and testing.
+     */
     jrx_regex_t* jrx() const { return _re->jrx(); }
 
     bool operator==(const RegExp& other) const {
@@ -306,9 +361,10 @@ private:
     friend class regexp::MatchState;
 
     // Backend for the searching and matching methods.
-    int16_t _search_pattern(jrx_match_state* ms, const char* data, size_t len, int32_t* so, int32_t* eo) const;
+    int16_t _search_pattern(jrx_regex_t* jrx, jrx_match_state* ms, const char* data, size_t len, int32_t* so,
+                            int32_t* eo) const;
 
-    std::shared_ptr<regexp::detail::CompiledRegExp> _re;
+    std::shared_ptr<const regexp::detail::CompiledRegExp> _re;
 };
 
 namespace detail::adl {
@@ -0,0 +1,106 @@
+// Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace hilti::rt::stream::detail {
+
+/**
+ * Cache of memory blocks for stream chunks and their payloads, organized into
+ * power-of-two size classes. One of these exists per execution context.
+ * Blocks released back to the pool are kept on per-class free lists for
+ * reuse, up to a fixed amount of memory per class; requests that exceed the
+ * largest size class go directly to the heap.
+ *
+ * All blocks are plain heap allocations, so a block obtained from one pool
+ * may safely be released into another one, or directly to the heap.
+ */
+class ChunkPool {
+public:
+    /** Statistics about the pool's operation. */
+    struct Statistics {
+        uint64_t cached_bytes = 0; //< bytes currently held on free lists for reuse
+        uint64_t reused = 0;       //< number of allocations served from free lists
+        uint64_t allocated = 0;    //< number of allocations that went to the heap
+    };
+
+    /** Size of the smallest size class. */
+    static constexpr size_t MinBlockSize = 64;
+
+    /** Size of the largest size class; larger blocks bypass the pool. */
+    static constexpr size_t MaxBlockSize = static_cast<size_t>(64 * 1024);
+
+    /** Maximum number of bytes kept on each size class' free list. */
+    static constexpr size_t MaxCachedBytesPerClass = static_cast<size_t>(1024 * 1024);
+
+    ChunkPool() = default;
+    ~ChunkPool() { clear(); }
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool(ChunkPool&&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+    ChunkPool& operator=(ChunkPool&&) = delete;
+
+    /**
+     * Returns the actual size of the block that `allocate()` will return
+     * for a request of a given size. That's the size rounded up to the next
+     * size class, or the size itself if it exceeds the largest class.
+     */
+    static size_t capacity(size_t size) {
+        if ( size > MaxBlockSize )
+            return size;
+
+        size_t c = MinBlockSize;
+        while ( c < size )
+            c <<= 1U;
+
+        return c;
+    }
+
+    /**
+     * Returns a block of memory with room for at least `size` bytes. The
+     * block's actual size is `capacity(size)`.
+     */
+    void* allocate(size_t size);
+
+    /**
+     * Releases a block previously returned by `allocate()`.
+     *
+     * @param p block to release
+     * @param capacity the block's actual size as returned by `capacity()`
+     */
+    void deallocate(void* p, size_t capacity);
+
+    /** Returns all cached blocks to the heap. */
+    void clear();
+
+    /** Returns statistics about the pool's operation. */
+    const Statistics& statistics() const { return _statistics; }
+
+private:
+    static constexpr size_t NumSizeClasses = 11; // 64 bytes to 64 KiB
+
+    static size_t _sizeClass(size_t capacity);
+
+    std::array<std::vector<void*>, NumSizeClasses> _free;
+    Statistics _statistics;
+};
+
+/**
+ * Allocates a block of memory with room for at least `size` bytes from the
+ * current context's chunk pool, or from the heap if there's no context.
+ * Returns the block's actual size in `capacity`.
+ */
+void* allocate(size_t size, size_t* capacity);
+
+/**
+ * Releases a block of memory previously returned by `allocate()` into the
+ * current context's chunk pool, or to the heap if there's no context.
+ */
+void deallocate(void* p, size_t capacity);
+
+} // namespace hilti::rt::stream::detail
@@ -20,6 +20,7 @@
 #include <hilti/rt/result.h>
 #include <hilti/rt/safe-int.h>
 #include <hilti/rt/types/bytes.h>
+#include <hilti/rt/types/stream-pool.h>
 #include <hilti/rt/types/time.h>
 #include <hilti/rt/types/vector.h>
 #include <hilti/rt/util.h>
@@ -86,6 +87,33 @@ using Size = integer::safe<uint64_t>;
 /** Direction of a search. */
 enum class Direction : int64_t { Forward, Backward };
 
+/**
+ * Immutable, reference-counted payload that can be appended to multiple
+ * streams without copying. Each stream keeps a reference to the payload for
+ * as long as it needs the data.
+ */
+class SharedData : public intrusive_ptr::ManagedObject {
+public:
+    /**
+     * Constructor.
+     *
+     * @param data payload to take over
+     */
+    explicit SharedData(std::string data) : _data(std::move(data)) {}
+
+    /** Returns a pointer to the first byte of the payload. */
+    const Byte* data() const { return reinterpret_cast<const Byte*>(_data.data()); }
+
+    /** Returns the size of the payload. */
+    size_t size() const { return _data.size(); }
+
+private:
+    const std::string _data;
+};
+
+/** Reference to a shared payload. */
+using SharedDataPtr = IntrusivePtr<SharedData>;
+
 namespace detail {
 
 class Chain;
@@ -97,6 +125,9 @@ struct Gap {
     size_t size;
 };
 
+// Shift table for Boyer-Moore-Horspool searching, indexed by byte value.
+using SkipTable = std::array<size_t, 256>;
+
 /**
  * Represents one block of continuous data inside a stream instance. A
  * stream's *Chain* links multiple of these chunks to represent all of its
@@ -124,8 +155,19 @@ public:
     // Constructs a gap chunk which signifies empty data.
     Chunk(const Offset& o, size_t len) : _offset(o), _size(len) { assert(_size > 0); }
 
+    // Constructs a chunk that references a shared payload without copying it.
+    Chunk(const Offset& o, SharedDataPtr shared)
+        : _offset(o), _size(shared->size()), _data(shared->data()), _shared(std::move(shared)) {
+        assert(_size > 0);
+    }
+
     Chunk(const Chunk& other)
-        : _offset(other._offset), _size(other._size), _data(other._data), _chain(other._chain), _next(nullptr) {
+        : _offset(other._offset),
+          _size(other._size),
+          _data(other._data),
+          _chain(other._chain),
+          _shared(other._shared),
+          _next(nullptr) {
         if ( other.isOwning() )
             makeOwning();
     }
@@ -136,6 +178,7 @@ public:
           _allocated(other._allocated),
           _data(other._data),
           _chain(other._chain),
+          _shared(std::move(other._shared)),
           _next(std::move(other._next)) {
         other._size = 0;
         other._allocated = 0;
@@ -153,6 +196,7 @@ public:
         _data = other._data;
         _allocated = 0;
         _chain = other._chain;
+        _shared = other._shared;
         _next = nullptr;
 
         if ( other.isOwning() )
@@ -163,13 +207,14 @@ public:
 
     Chunk& operator=(Chunk&& other) noexcept {
         if ( _allocated > 0 )
-            delete[] _data;
+            detail::deallocate(const_cast<Byte*>(_data), _allocated); // cast is safe because it's allocated
 
         _offset = other._offset;
         _size = other._size;
         _allocated = other._allocated;
         _data = other._data;
         _chain = other._chain;
+        _shared = std::move(other._shared);
         _next = std::move(other._next);
 
         other._size = 0;
@@ -181,10 +226,19 @@ public:
 
     ~Chunk() { destroy(); }
 
+    // Chunk instances come out of the context's chunk pool.
+    static void* operator new(size_t size) {
+        size_t capacity = 0;
+        return detail::allocate(size, &capacity);
+    }
+
+    static void operator delete(void* p, size_t size) { detail::deallocate(p, ChunkPool::capacity(size)); }
+
     Offset offset() const { return _offset; }
     Offset endOffset() const { return _offset + size(); }
     bool isGap() const { return _data == nullptr; };
-    bool isOwning() const { return _allocated > 0; }
+    bool isOwning() const { return _allocated > 0 || _shared; }
+    bool isShared() const { return static_cast<bool>(_shared); }
     bool inRange(const Offset& offset) const { return offset >= _offset && offset < endOffset(); }
 
     const Byte* data() const {
@@ -227,15 +281,15 @@ public:
     }
 
     // Creates a new copy of the data internally if the chunk is currently not
-    // owning it. On return, is guaranteed to now own the data.
+    // owning it. On return, is guaranteed to now own the data (which may be
+    // through a reference to a shared payload).
     void makeOwning() {
-        if ( _size == 0 || _allocated > 0 || ! _data )
+        if ( _size == 0 || _allocated > 0 || _shared || ! _data )
             return;
 
-        auto data = std::make_unique<Byte[]>(_size);
-        memcpy(data.get(), _data, _size);
-        _allocated = _size;
-        _data = data.release();
+        auto* data = static_cast<Byte*>(detail::allocate(_size, &_allocated));
+        memcpy(data, _data, _size);
+        _data = data;
     }
 
     void debugPrint(std::ostream& out) const;
@@ -307,6 +361,7 @@ private:
     const Byte* _data = nullptr;   // chunk's payload, or null for gap chunks
     const Chain* _chain = nullptr; // chain this chunk is part of, or null if not linked to a chain yet (non-owning;
                                    // will stay valid at least as long as the current chunk does)
+    SharedDataPtr _shared;         // shared payload that `_data` points into, if any
     std::unique_ptr<Chunk> _next = nullptr; // next chunk in chain, or null if last
 };
 
@@ -327,6 +382,7 @@ public:
     /** Moves a chunk and all its successors into a new chain. */
     Chain(std::unique_ptr<Chunk> head) : _head(std::move(head)), _tail(_head->last()) {
         _head->setChain(this);
+        _indexChunks(_head.get());
 
         if ( auto size = _head->size() ) {
             if ( _head->isGap() ) {
@@ -386,6 +442,9 @@ public:
     // Appends a new chunk to the end, moving the data.
     void append(Bytes&& data);
 
+    // Appends a new chunk to the end, referencing the shared payload.
+    void append(const SharedDataPtr& data);
+
     // Appends another chain to the end.
     void append(Chain&& other);
 
@@ -407,6 +466,7 @@ public:
         _head_offset = 0;
         _tail = nullptr;
         _statistics = {};
+        _clearIndex();
     }
 
     // Turns the chain into a freshly initialized state.
@@ -416,6 +476,7 @@ public:
         _head_offset = 0;
         _tail = nullptr;
         _statistics = {};
+        _clearIndex();
     }
 
     void freeze() {
@@ -429,7 +490,7 @@ public:
     }
 
     // Returns the number of dynamic chunks allocated.
-    int numberOfChunks() const;
+    int numberOfChunks() const { return static_cast<int>(_index.size() - _index_head); }
 
     // Returns statistics for the chain. These are accumulative over the whole
     // lifetime of the chain.
@@ -446,6 +507,42 @@ private:
             throw Frozen("stream object can no longer be modified");
     }
 
+    // Entry in the chain's chunk index.
+    struct IndexEntry {
+        uint64_t offset; // start offset of chunk
+        Chunk* chunk;    // non-owning
+    };
+
+    // Adds index entries for a newly linked chunk and all its successors.
+    void _indexChunks(Chunk* c) {
+        for ( ; c; c = c->next() )
+            _index.push_back({c->offset().Ref(), c});
+    }
+
+    // Removes the index entry for the current head chunk.
+    void _unindexHead() {
+        assert(_index_head < _index.size());
+
+        if ( ++_index_head == _index.size() )
+            _clearIndex();
+
+        else if ( _index_head >= 64 && _index_head * 2 >= _index.size() ) {
+            // Compact once the trimmed prefix dominates, keeping trimming
+            // amortized constant time.
+            _index.erase(_index.begin(), _index.begin() + static_cast<std::ptrdiff_t>(_index_head));
+            _index_head = 0;
+        }
+    }
+
+    void _clearIndex() {
+        _index.clear();
+        _index_head = 0;
+    }
+
+    // Binary searches the index for the chunk containing *offset*. Returns
+    // null if not found.
+    Chunk* _lookupChunk(uint64_t offset) const;
+
     enum class State {
         Mutable, // content can be expanded an trimmed
         Frozen,  // content cannot be changed
@@ -472,6 +569,12 @@ private:
     stream::Statistics _statistics;
 
     std::unique_ptr<Chunk> _cached; // previously freed chunk for reuse
+
+    // All chunks linked from *head*, in order, for finding chunks by offset
+    // without walking the list. Entries before `_index_head` have been
+    // trimmed already; we drop them lazily so that trimming remains cheap.
+    std::vector<IndexEntry> _index;
+    size_t _index_head = 0;
 };
 
 } // namespace detail
@@ -1101,11 +1204,22 @@ inline void Chain::trim(const SafeConstIterator& i) {
 
 inline void Chain::trim(const UnsafeConstIterator& i) { trim(i.offset()); }
 
+inline Chunk* Chain::_lookupChunk(uint64_t offset) const {
+    const auto begin = _index.begin() + static_cast<std::ptrdiff_t>(_index_head);
+    const auto end = _index.end();
+
+    // Find the last chunk starting at or before the offset.
+    auto i = std::upper_bound(begin, end, offset, [](uint64_t o, const IndexEntry& e) { return o < e.offset; });
+    if ( i == begin )
+        return nullptr;
+
+    auto* c = (--i)->chunk;
+    return c->inRange(offset) ? c : nullptr;
+}
+
 inline const Chunk* Chain::findChunk(const Offset& offset, const Chunk* hint_prev) const {
     _ensureValid();
 
-    const Chunk* c = _head.get();
-
     // A very common way this function gets called without `hint_prev` is
     // `Stream::unsafeEnd` via `Chain::unsafeEnd` in construction of an
     // `UnsafeConstIterator` from a `SafeConstIterator`; in this case the chunk
@@ -1114,32 +1228,21 @@ inline const Chunk* Chain::findChunk(const Offset& offset, const Chunk* hint_pre
     if ( ! hint_prev )
         hint_prev = _tail;
 
-    if ( hint_prev && hint_prev->offset() <= offset )
-        c = hint_prev;
+    // Sequential access tends to stay inside the hinted chunk, or move on to
+    // the next one. Check those before searching the index.
+    if ( hint_prev && hint_prev->offset() <= offset ) {
+        if ( hint_prev->inRange(offset) )
+            return hint_prev;
 
-    while ( c && ! c->inRange(offset) )
-        c = c->next();
-
-    if ( c && ! c->inRange(offset) )
-        return nullptr;
+        if ( const auto* next = hint_prev->next(); next && next->inRange(offset) )
+            return next;
+    }
 
-    return c;
+    return _lookupChunk(offset.Ref());
 }
 
 inline Chunk* Chain::findChunk(const Offset& offset, Chunk* hint_prev) {
-    _ensureValid();
-
-    Chunk* c = _head.get();
-
-    // See comment above.
-    if ( ! hint_prev )
-        hint_prev = _tail;
-
-    if ( hint_prev && hint_prev->offset() <= offset )
-        c = hint_prev;
-
-    while ( c && ! c->inRange(offset) )
-        c = c->next();
+    auto* c = const_cast<Chunk*>(std::as_const(*this).findChunk(offset, hint_prev));
 
     if ( _tail && offset > _tail->endOffset() )
         return _tail;
@@ -1162,6 +1265,36 @@ inline SafeConstIterator::SafeConstIterator(const UnsafeConstIterator& i)
       _offset(i._offset),
       _chunk(i._chunk) {}
 
+/**
+ * A precompiled needle for forward searches inside stream views. It derives
+ * all search state upfront, so that repeated searches for the same data (e.g.,
+ * a constant delimiter) do not need to recompute it on each call.
+ */
+class Searcher {
+public:
+    /** Constructor creating a searcher for an empty needle. */
+    Searcher() = default;
+
+    /**
+     * Constructor.
+     *
+     * @param needle data to search for
+     */
+    explicit Searcher(Bytes needle);
+
+    /** Returns the data being searched for. */
+    const Bytes& needle() const { return _needle; }
+
+    /** Returns the size of the data being searched for. */
+    uint64_t size() const { return _needle.size(); }
+
+private:
+    friend class View;
+
+    Bytes _needle;
+    detail::SkipTable _skip = {};
+};
+
 /**
  * A subrange of a stream instance. The view is maintained through two safe
  * iterators; no data is copied. That makes the view cheap to create and pass
@@ -1381,6 +1514,48 @@ public:
             return _findBackward(v, n);
     }
 
+    /**
+     * Searches for the first occurrence of a precompiled needle.
+     *
+     * @param s searcher for the data to search for
+     * @return tuple where the 1st element is a boolean indicating whether
+     * the needle has been found; if yes, the 2nd element points to the 1st
+     * byte; if no, the 2nd element points to the first byte so that no
+     * earlier position has even a partial match of the needle. That means
+     * that once more data becomes available, a search can resume from that
+     * position instead of starting over.
+     */
+    Tuple<bool, SafeConstIterator> find(const Searcher& s) const {
+        _ensureValid();
+        auto x = find(s, UnsafeConstIterator());
+        return tuple::make(tuple::get<0>(x), SafeConstIterator(tuple::get<1>(x)));
+    }
+
+    /**
+     * Searches for the first occurrence of a precompiled needle.
+     *
+     * @param s searcher for the data to search for
+     * @param n starting point, which must be inside this view
+     * @return tuple with the same semantics as for `find(const Searcher&)`
+     */
+    Tuple<bool, SafeConstIterator> find(const Searcher& s, const SafeConstIterator& n) const {
+        _ensureValid();
+        _ensureSameChain(n);
+        auto x = find(s, UnsafeConstIterator(n));
+        return tuple::make(tuple::get<0>(x), SafeConstIterator(tuple::get<1>(x)));
+    }
+
+    /**
+     * Searches for the first occurrence of a precompiled needle.
+     *
+     * @param s searcher for the data to search for
+     * @param n starting point, which must be inside this view
+     * @return tuple with the same semantics as for `find(const Searcher&)`
+     */
+    Tuple<bool, UnsafeConstIterator> find(const Searcher& s, UnsafeConstIterator n) const {
+        return _findForward(reinterpret_cast<const Byte*>(s._needle.data()), s._needle.size(), n, &s._skip);
+    }
+
     /**
      * Advances the view's starting position to a new place.
      *
@@ -1399,11 +1574,41 @@ public:
      */
     View advance(const integer::safe<uint64_t>& i) const { return View(begin() + i, _end); }
 
+    /**
+     * Advances the view's starting position by a given number of stream
+     * bytes, modifying the view itself. Unlike `advance()`, this does not need
+     * to create a new view instance.
+     *
+     * @param i the number of stream bytes to advance.
+     */
+    void advanceInPlace(const integer::safe<uint64_t>& i) { _begin += i; }
+
     /**
      * Advances the view to the next, none gap offset. This always advances at least by one byte.
      */
     View advanceToNextData() const;
 
+    /**
+     * Returns a pointer to the view's first bytes if at least a given number
+     * of them is available in a single, contiguous block of memory. This
+     * provides direct access to the data without copying it.
+     *
+     * @param n number of bytes that must be available contiguously
+     * @return pointer to the first byte, or null if the *n* bytes are not
+     * available inside the view, or not contiguous
+     */
+    const Byte* contiguousData(uint64_t n) const {
+        const auto* c = _begin.chunk();
+        if ( ! c || c->isGap() || ! c->inRange(_begin.offset()) )
+            return nullptr;
+
+        const auto end = _begin.offset() + n;
+        if ( end > c->endOffset() || (_end && end > _end->offset()) )
+            return nullptr;
+
+        return c->data(_begin.offset());
+    }
+
     /**
      * Extracts a subrange of bytes from the view, returned as a new view.
      *
@@ -1627,6 +1832,13 @@ private:
     // Common backend for forward searching.
     Tuple<bool, UnsafeConstIterator> _findForward(const Bytes& v, UnsafeConstIterator n) const;
 
+    // Common backend for forward searching, operating on a raw needle. This
+    // searches chunk-wise over the underlying data, only stitching together
+    // data from multiple chunks for matches straddling chunk boundaries. If
+    // given, *skip* must be the needle's precomputed Horspool table.
+    Tuple<bool, UnsafeConstIterator> _findForward(const Byte* needle, size_t needle_size, UnsafeConstIterator n,
+                                                  const detail::SkipTable* skip = nullptr) const;
+
     SafeConstIterator _begin;
     std::optional<SafeConstIterator> _end;
 };
@@ -1787,6 +1999,15 @@ public:
      */
     void append(Bytes&& data);
 
+    /**
+     * Appends a shared payload without copying it. The stream keeps a
+     * reference to the payload, which can be appended to further streams as
+     * well. This function does not invalidate iterators.
+     *
+     * @param data payload to append
+     */
+    void append(const stream::SharedDataPtr& data);
+
     /**
      * Appends the content of a raw memory area, taking ownership. This function does not invalidate iterators.
      * @param data pointer to `Bytes` to append
@@ -364,10 +364,11 @@ auto wrap_expression(Func&& f) {
 /** Corresponds to `hilti::printTuple`. */
 template<typename... Ts>
 void print(const Tuple<Ts...>& x, bool newline = true) {
-    if ( ! configuration::get().cout )
+    auto* out = configuration::detail::printStream();
+    if ( ! out )
         return;
 
-    auto& cout = configuration::get().cout->get();
+    auto& cout = *out;
 
     std::vector<std::string> elems;
     [&]<std::size_t... Is>(std::index_sequence<Is...> /*unused*/) {
@@ -28,8 +28,10 @@
 #include <utility>
 #include <vector>
 
+#include <hilti/rt/autogen/config.h>
 #include <hilti/rt/exception.h>
 #include <hilti/rt/filesystem.h>
+#include <hilti/rt/intrusive-ptr.h>
 #include <hilti/rt/macros.h>
 #include <hilti/rt/result.h>
 #include <hilti/rt/types/set_fwd.h>
@@ -123,13 +125,16 @@ extern std::string version();
 /** Statistics about resource usage. */
 struct ResourceUsage {
     // Note when changing this, update `resource_usage()`.
-    double user_time;              //< user time since runtime initialization
-    double system_time;            //< system time since runtime initialization
-    uint64_t memory_heap;          //< current size of heap in bytes
-    uint64_t num_fibers;           //< number of fibers currently in use
-    uint64_t max_fibers;           //< high-water mark for number of fibers in use
-    uint64_t max_fiber_stack_size; //< global high-water mark for fiber stack size
-    uint64_t cached_fibers;        //< number of fibers currently cached for reuse
+    double user_time;               //< user time since runtime initialization
+    double system_time;             //< system time since runtime initialization
+    uint64_t memory_heap;           //< current size of heap in bytes
+    uint64_t num_fibers;            //< number of fibers currently in use
+    uint64_t max_fibers;            //< high-water mark for number of fibers in use
+    uint64_t max_fiber_stack_size;  //< global high-water mark for fiber stack size
+    uint64_t cached_fibers;         //< number of fibers currently cached for reuse
+    uint64_t stream_pool_cached;    //< bytes of stream chunk memory currently cached for reuse by current context
+    uint64_t stream_pool_reused;    //< number of stream chunk allocations served from current context's cache
+    uint64_t stream_pool_allocated; //< number of stream chunk allocations that current context took from the heap
 };
 
 /** Returns statistics about the current resource usage. */
@@ -694,6 +699,46 @@ namespace control {
 template<typename Data, typename Error>
 class Reference;
 
+namespace detail {
+#ifdef HILTI_RT_SINGLE_THREADED
+// State shared between a `Block` and its references. With the runtime
+// configured for single-threaded use, this uses non-atomic reference
+// counting, which makes copying references (e.g., safe iterators) cheaper.
+// Blocks and their references must then never be used from more than one
+// thread.
+struct State : intrusive_ptr::ManagedObject {
+    bool expired = false; // set once the owning block goes away or resets
+};
+
+using BlockState = IntrusivePtr<State>;
+using ReferenceState = IntrusivePtr<State>;
+
+inline BlockState makeState() { return make_intrusive<State>(); }
+
+inline void expireState(BlockState* state) {
+    if ( *state ) {
+        (*state)->expired = true;
+        *state = nullptr;
+    }
+}
+
+inline bool isExpired(const ReferenceState& state) { return ! state || state->expired; }
+inline bool isSameState(const ReferenceState& a, const ReferenceState& b) { return a == b; }
+#else
+// A `Block` owns its state, with references observing it weakly.
+using BlockState = std::shared_ptr<void>;
+using ReferenceState = std::weak_ptr<void>;
+
+inline BlockState makeState() { return std::make_shared<bool>(); }
+inline void expireState(BlockState* state) { state->reset(); }
+inline bool isExpired(const ReferenceState& state) { return state.expired(); }
+
+inline bool isSameState(const ReferenceState& a, const ReferenceState& b) {
+    return ! a.owner_before(b) && ! b.owner_before(a);
+}
+#endif
+} // namespace detail
+
 /**
  * Helper class for loosely tracking liveliness of some memory.
  *
@@ -719,16 +764,26 @@ public:
     Block(const Block& other) : Block(other._data) {}
     Block(Block&&) = default;
 
+    ~Block() { Reset(); }
+
     Block& operator=(const Block& other) {
         if ( this != &other ) {
             _data = other._data;
-            _control.reset();
+            Reset();
         }
 
         return *this;
     }
 
-    Block& operator=(Block&&) = default;
+    Block& operator=(Block&& other) noexcept {
+        if ( this != &other ) {
+            Reset();
+            _control = std::move(other._control);
+            _data = other._data;
+        }
+
+        return *this;
+    }
 
     friend bool operator==(const Block& a, const Block& b) {
         return std::tie(a._control, a._data) == std::tie(b._control, b._data);
@@ -741,7 +796,7 @@ public:
      */
     /* implicit */ operator Ref() const {
         if ( ! _control )
-            _control = std::make_shared<bool>();
+            _control = detail::makeState();
 
         return {_control, _data};
     }
@@ -749,10 +804,10 @@ public:
     /**
      * Invalidate every Reference to this Block.
      */
-    void Reset() { _control.reset(); }
+    void Reset() { detail::expireState(&_control); }
 
 private:
-    mutable std::shared_ptr<void> _control;
+    mutable detail::BlockState _control;
     Data* _data = nullptr;
 };
 
@@ -775,7 +830,7 @@ public:
     /**
      * Check whether getting a value with `get` would return a value.
      */
-    bool isValid() const { return _data && ! _control.expired(); }
+    bool isValid() const { return _data && ! _expired(); }
 
     /**
      * Get reference to the controlled object.
@@ -786,7 +841,7 @@ public:
         if ( ! _data )
             throw Error("underlying object is invalid");
 
-        if ( _control.expired() )
+        if ( _expired() )
             throw Error("underlying object has expired");
 
         return *_data;
@@ -801,14 +856,14 @@ public:
         if ( ! _data )
             throw Error("underlying object is invalid");
 
-        if ( _control.expired() )
+        if ( _expired() )
             throw Error("underlying object has expired");
 
         return *_data;
     }
 
     friend bool operator==(const Reference& a, const Reference& b) {
-        return ! a._control.owner_before(b._control) && ! b._control.owner_before(a._control);
+        return detail::isSameState(a._control, b._control);
     }
 
     friend bool operator!=(const Reference& a, const Reference& b) { return ! (a == b); }
@@ -817,9 +872,11 @@ private:
     template<typename T, typename E>
     friend class Block;
 
-    Reference(std::weak_ptr<void> control, Data* data) : _control(std::move(control)), _data(data) {}
+    Reference(detail::ReferenceState control, Data* data) : _control(std::move(control)), _data(data) {}
+
+    bool _expired() const { return detail::isExpired(_control); }
 
-    std::weak_ptr<void> _control;
+    detail::ReferenceState _control;
     Data* _data = nullptr;
 };
 
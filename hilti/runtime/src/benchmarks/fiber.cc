@@ -10,6 +10,11 @@
 #endif
 
 #include <cstdlib>
+#include <fstream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include <hilti/rt/configuration.h>
 #include <hilti/rt/fiber.h>
@@ -171,6 +176,60 @@ static void execute_many_resume(benchmark::State& state) {
     hilti::rt::done();
 }
 
+// Returns the process' current resident memory in bytes, or zero if unknown.
+static double resident_memory() {
+#ifndef _WIN32
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+
+    if ( statm >> size >> resident )
+        return static_cast<double>(resident * static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)));
+#endif
+
+    return 0;
+}
+
+// Runs fibers going deep into their stacks, either with the fiber cache
+// trimmed regularly, releasing memory that idle fibers touched beyond
+// `fiber_stack_retain_size`, or never. Reports the resident memory
+// afterwards.
+static void execute_deep(benchmark::State& state) {
+    auto stack_usage = state.range(0);
+    auto release = state.range(1);
+
+    auto config = hilti::rt::configuration::get();
+    if ( ! release )
+        config.fiber_cache_trim_interval = 0;
+
+    hilti::rt::configuration::set(config);
+    hilti::rt::init();
+    hilti::rt::detail::Fiber::primeCache();
+
+    for ( auto _ : state ) {
+        (void)_;
+        state.PauseTiming();
+
+        auto r = hilti::rt::Resumable([stack_usage](hilti::rt::resumable::Handle* h) {
+            auto* xs = reinterpret_cast<char*>(alloca(stack_usage));
+            benchmark::DoNotOptimize(xs[0]);
+            benchmark::DoNotOptimize(xs[stack_usage - 1]);
+            h->yield();
+            return hilti::rt::Nothing();
+        });
+
+        state.ResumeTiming();
+        r.run();
+        r.resume();
+        assert(r); // must have finished
+    }
+
+    state.counters["resident_memory"] = resident_memory();
+    hilti::rt::done();
+
+    hilti::rt::configuration::set(hilti::rt::Configuration());
+}
+
 const auto addl_stack_usage =
     static_cast<int64_t>(static_cast<double>(hilti::rt::configuration::get().fiber_min_stack_size) * 0.9);
 
@@ -180,4 +239,6 @@ BENCHMARK(execute_yield_to_other)->ArgName("addl_stack_usage")->Range(1, addl_st
 BENCHMARK(execute_many)->ArgNames({"addl_stack_usage", "fibers"})->Ranges({{1, addl_stack_usage}, {1, 4096}});
 BENCHMARK(execute_many_resume)->ArgNames({"addl_stack_usage", "fibers"})->Ranges({{1, addl_stack_usage}, {1, 4096}});
 
+BENCHMARK(execute_deep)->ArgNames({"stack_usage", "release"})->Ranges({{64 * 1024, 512 * 1024}, {0, 1}});
+
 BENCHMARK_MAIN();
@@ -0,0 +1,113 @@
+// Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include <hilti/rt/init.h>
+#include <hilti/rt/types/bytes.h>
+#include <hilti/rt/types/stream.h>
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+#include <benchmark/benchmark.h>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+// Size of the data searched by the benchmarks, split into chunks of the size
+// given as the benchmark's argument.
+static const uint64_t data_size = 1'000'000;
+
+// Builds a stream of `data_size` bytes which does not contain `needle`
+// except for a single occurrence at the very end.
+static hilti::rt::Stream make_stream(uint64_t chunk_size, const std::string& needle) {
+    auto data = std::string(data_size - needle.size(), 'x') + needle;
+
+    hilti::rt::Stream s;
+    for ( uint64_t i = 0; i < data.size(); i += chunk_size )
+        s.append(data.data() + i, std::min<uint64_t>(chunk_size, data.size() - i));
+
+    return s;
+}
+
+static void find_byte(benchmark::State& state) {
+    hilti::rt::init();
+
+    auto s = make_stream(state.range(0), "\n");
+    auto v = s.view();
+
+    // NOLINTNEXTLINE
+    for ( auto _ : state )
+        benchmark::DoNotOptimize(v.find(hilti::rt::stream::Byte('\n')));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data_size));
+}
+
+static void find_bytes(benchmark::State& state) {
+    hilti::rt::init();
+
+    const auto needle = hilti::rt::Bytes(std::string(state.range(1), 'y'));
+    auto s = make_stream(state.range(0), needle.str());
+    auto v = s.view();
+
+    // NOLINTNEXTLINE
+    for ( auto _ : state )
+        benchmark::DoNotOptimize(v.find(needle));
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data_size));
+}
+
+BENCHMARK(find_byte)->ArgName("chunk_size")->RangeMultiplier(8)->Range(8, 1'000'000);
+BENCHMARK(find_bytes)->ArgNames({"chunk_size", "needle_size"})->Ranges({{8, 1'000'000}, {2, 32}});
+
+// Builds a stream consisting of `n` chunks of 16 bytes each.
+static hilti::rt::Stream make_chunked_stream(uint64_t n) {
+    const auto chunk = std::string(16, 'x');
+
+    hilti::rt::Stream s;
+    for ( uint64_t i = 0; i < n; i++ )
+        s.append(chunk.data(), chunk.size());
+
+    return s;
+}
+
+static void random_access(benchmark::State& state) {
+    hilti::rt::init();
+
+    const auto n = static_cast<uint64_t>(state.range(0));
+    auto s = make_chunked_stream(n);
+    const auto size = s.size().Ref();
+
+    // Cheap deterministic pseudo-random sequence of offsets.
+    uint64_t offset = 0;
+
+    // NOLINTNEXTLINE
+    for ( auto _ : state ) {
+        offset = (offset * 6364136223846793005ULL + 1442695040888963407ULL);
+        benchmark::DoNotOptimize(*s.at(offset % size));
+    }
+}
+
+static void trim_head(benchmark::State& state) {
+    hilti::rt::init();
+
+    const auto n = static_cast<uint64_t>(state.range(0));
+
+    // NOLINTNEXTLINE
+    for ( auto _ : state ) {
+        state.PauseTiming();
+        auto s = make_chunked_stream(n);
+        state.ResumeTiming();
+
+        for ( uint64_t i = 1; i <= n; i++ )
+            s.trim(s.at(i * 16));
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+BENCHMARK(random_access)->ArgName("chunks")->RangeMultiplier(10)->Range(10, 100'000);
+BENCHMARK(trim_head)->ArgName("chunks")->RangeMultiplier(10)->Range(10, 100'000);
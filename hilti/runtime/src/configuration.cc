@@ -5,6 +5,7 @@
 
 #include <hilti/rt/autogen/config.h>
 #include <hilti/rt/configuration.h>
+#include <hilti/rt/context.h>
 #include <hilti/rt/global-state.h>
 #include <hilti/rt/init.h>
 #include <hilti/rt/logging.h>
@@ -31,3 +32,13 @@ void configuration::set(Configuration cfg) {
 
     *detail::__configuration = std::move(cfg);
 }
+
+std::ostream* configuration::detail::printStream() {
+    if ( auto* ctx = context::detail::get(true); ctx && ctx->cout )
+        return ctx->cout;
+
+    if ( const auto& cout = get().cout )
+        return &cout->get();
+
+    return nullptr;
+}
@@ -6,6 +6,7 @@
 #include <hilti/rt/context.h>
 #include <hilti/rt/global-state.h>
 #include <hilti/rt/logging.h>
+#include <hilti/rt/types/regexp.h>
 #include <hilti/rt/util.h>
 
 using namespace hilti::rt;
@@ -35,10 +36,18 @@ Context::Context(vthread::ID vid) : vid(vid) {
         return;
     }
 
+    // The generated initialization code accesses the globals through the
+    // current context, so make this one current while it runs. Modules
+    // compiled without dynamic globals keep theirs in static storage shared
+    // with the master context, which has already initialized them.
+    auto* old = context::detail::set(this);
+
     for ( const auto& m : globalState()->hilti_modules ) {
-        if ( m.init_globals )
+        if ( m.init_globals && m.globals_idx )
             (*m.init_globals)(this);
     }
+
+    context::detail::set(old);
 }
 
 Context::~Context() {
@@ -10,6 +10,7 @@ using namespace hilti::rt::detail;
 
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 #include <utility>
 
 using namespace hilti::rt;
@@ -29,6 +30,8 @@ void detail::DebugLogger::print(std::string_view stream, std::string_view msg) {
     if ( i == _streams.end() )
         return;
 
+    std::scoped_lock lock(_mutex);
+
     if ( ! _output ) {
         if ( _path == "/dev/stdout" )
             _output = &std::cout;
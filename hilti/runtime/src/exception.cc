@@ -1,9 +1,12 @@
 // Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
 
+#include <cassert>
 #include <clocale>
+#include <utility>
 
 #include <hilti/rt/configuration.h>
 #include <hilti/rt/exception.h>
+#include <hilti/rt/global-state.h>
 #include <hilti/rt/logging.h>
 #include <hilti/rt/profiler.h>
 #include <hilti/rt/types/string.h>
@@ -65,7 +68,18 @@ Exception::Exception(Internal,
                      std::string_view desc,
                      std::string_view location)
     : std::runtime_error({what.data(), what.size()}), _description(desc), _location(location) {
-    if ( isInitialized() )
+    _init(type);
+}
+
+Exception::Exception(Internal, const char* type, exception::Deferred deferred)
+    : std::runtime_error(""), _deferred(std::move(deferred)) {
+    assert(_deferred->render);
+    _init(type);
+}
+
+void Exception::_init(const char* type) {
+    // Only build the profiler's name if it's actually going to be used.
+    if ( isInitialized() && detail::unsafeGlobalState()->profiling_enabled )
         profiler::start(std::string("hilti/exception/") + type);
 
     if ( configuration::get().abort_on_exceptions && ! detail::globalState()->disable_abort_on_exceptions ) {
@@ -77,6 +91,30 @@ Exception::Exception(Internal,
     }
 }
 
+void Exception::_render() const {
+    if ( ! _what.empty() )
+        return;
+
+    _description = _deferred->render(*_deferred);
+
+    if ( ! _deferred->location.empty() )
+        _what = fmt("%s (%s)", _description, _deferred->location);
+    else
+        _what = _description;
+}
+
+const char* Exception::what() const noexcept {
+    if ( ! _deferred )
+        return std::runtime_error::what();
+
+    try {
+        _render();
+        return _what.c_str();
+    } catch ( ... ) {
+        return "<cannot render exception>";
+    }
+}
+
 Exception::Exception(Internal, const char* type, std::string_view desc)
     : Exception(Internal(),
                 type,
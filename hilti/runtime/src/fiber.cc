@@ -2,6 +2,8 @@
 
 #include <fiber/fiber.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 #if defined(_MSC_VER)
@@ -10,6 +12,9 @@
 
 #if defined(_WIN32)
 #include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include <hilti/rt/autogen/config.h>
@@ -61,6 +66,14 @@ static const auto FiberGuardFlags = 0; // leak sanitizer may abort with "Tracer
 // ASAN during fiber switching when using GCC/libc++.
 static const std::string_view debug_stream_fibers = "fibers";
 
+// Raises a statistics counter shared across threads to a new value if that's
+// larger than its current one.
+static void _updateMaximum(std::atomic<uint64_t>* max, uint64_t value) {
+    auto current = max->load(std::memory_order_relaxed);
+    while ( value > current && ! max->compare_exchange_weak(current, value, std::memory_order_relaxed) )
+        ;
+}
+
 // Wrapper similar to HILTI_RT_DEBUG that adds the current fiber to the message.
 #define HILTI_RT_FIBER_DEBUG(tag, msg)                                                                                 \
     {                                                                                                                  \
@@ -143,6 +156,9 @@ void __fiber_switch_trampoline(void* argsp) {
     if ( from->_type == detail::Fiber::Type::SharedStack )
         from->_stack_buffer.save();
 
+    if ( from->_type == detail::Fiber::Type::SharedStack || from->_type == detail::Fiber::Type::IndividualStack )
+        from->_recordStackUsage(from->_stack_buffer.activeSize());
+
     // If the destination fiber has type shared stack, but doesn't yet
     // have the stack set (nullptr), initialize it first. Otherwise,
     // restore the saved stack form the stack buffer into the shared stack.
@@ -314,11 +330,7 @@ detail::Fiber::Fiber(Type type) : _type(type), _fiber(std::make_unique<::Fiber>(
         case Type::IndividualStack: {
             // We do bookkeeping only for the "real" fibers with payload.
             ++_total_fibers;
-            ++_current_fibers;
-
-            // NOLINTNEXTLINE(readability-use-std-min-max)
-            if ( _current_fibers > _max_fibers )
-                _max_fibers = _current_fibers;
+            _updateMaximum(&_max_fibers, ++_current_fibers);
         }
 
         case Type::SwitchTrampoline:
@@ -425,8 +437,37 @@ size_t detail::StackBuffer::liveRemainingSize() const {
     return static_cast<size_t>(sp - lower);
 }
 
+size_t detail::StackBuffer::liveUsedSize() const { return ::fiber_stack_size(_fiber) - liveRemainingSize(); }
+
 size_t detail::StackBuffer::activeSize() const { return ::fiber_stack_used_size(_fiber); }
 
+// Returns the pages fully inside a region of stack memory to the OS. The
+// region must not contain any live stack content. The memory remains mapped,
+// and will read as zero when touched next.
+static void releaseStackMemory(char* lower, char* upper) {
+#ifndef _WIN32
+    static const auto page_size = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+
+    auto start = (reinterpret_cast<uintptr_t>(lower) + page_size - 1) & ~(page_size - 1);
+    auto end = reinterpret_cast<uintptr_t>(upper) & ~(page_size - 1);
+
+    if ( start >= end )
+        return;
+
+    // Failure isn't critical, the memory just stays resident.
+    ::madvise(reinterpret_cast<void*>(start), end - start, MADV_DONTNEED);
+#endif
+}
+
+void detail::StackBuffer::releaseUnused(size_t retain) const {
+    auto [lower, upper] = allocatedRegion();
+    if ( ! lower )
+        return;
+
+    retain = std::min(retain, static_cast<size_t>(upper - lower));
+    releaseStackMemory(lower, std::min(activeRegion().first, upper - retain));
+}
+
 void detail::StackBuffer::save() {
     auto want_buffer_size = std::max(activeSize(), configuration::get().fiber_shared_stack_swap_size_min);
 
@@ -680,6 +721,62 @@ void detail::Fiber::abort() {
     }
 }
 
+void detail::Fiber::_recordStackUsage(size_t size) {
+    if ( size > _stack_high_water )
+        _stack_high_water = size;
+
+    if ( _type == Type::SharedStack ) {
+        auto& context = context::detail::get()->fiber;
+        context.shared_stack_high_water = std::max(context.shared_stack_high_water, size);
+        context.shared_stack_recent_high_water = std::max(context.shared_stack_recent_high_water, size);
+    }
+}
+
+void detail::Fiber::_trimCache(FiberContext* context) {
+    const auto retain = configuration::detail::unsafeGet().fiber_stack_retain_size;
+
+    // Pages that a fiber's stack touched during a deep recursion stay
+    // resident afterwards. For fibers that haven't been reused since the
+    // last trim, return those beyond what a typical payload needs. As we
+    // reuse fibers from the back of the cache, these are the ones at the
+    // front. The stacks themselves keep their full size.
+    for ( size_t i = 0; i < std::min(context->cache_low_water, context->cache.size()); i++ ) {
+        auto* f = context->cache[i].get();
+
+        if ( f->_type != Type::IndividualStack || f->_stack_high_water <= retain )
+            continue;
+
+        HILTI_RT_FIBER_DEBUG("trim",
+                             fmt("releasing stack memory of idle fiber %s above %zu bytes (high water %zu bytes)",
+                                 *f,
+                                 retain,
+                                 f->_stack_high_water));
+
+        f->_stack_buffer.releaseUnused(retain);
+        f->_stack_high_water = 0;
+    }
+
+    // Same for the shared stack if recent fibers haven't gone that deep,
+    // which we can touch only while no fiber is executing on it. All others
+    // have swapped out their content.
+    if ( context->current->_type != Type::SharedStack && context->shared_stack_high_water > retain &&
+         context->shared_stack_recent_high_water <= retain ) {
+        HILTI_RT_FIBER_DEBUG("trim",
+                             fmt("releasing shared stack memory above %zu bytes (high water %zu bytes)",
+                                 retain,
+                                 context->shared_stack_high_water));
+
+        auto* lower = reinterpret_cast<char*>(context->shared_stack->stack);
+        auto* upper = lower + context->shared_stack->stack_size;
+        releaseStackMemory(lower, upper - std::min(retain, context->shared_stack->stack_size));
+        context->shared_stack_high_water = 0;
+    }
+
+    context->cache_low_water = context->cache.size();
+    context->completions_since_trim = 0;
+    context->shared_stack_recent_high_water = 0;
+}
+
 std::unique_ptr<detail::Fiber> detail::Fiber::create() {
     auto* context = context::detail::get();
     auto& cache = context->fiber.cache;
@@ -687,6 +784,7 @@ std::unique_ptr<detail::Fiber> detail::Fiber::create() {
         auto f = std::move(cache.back());
         cache.pop_back();
         --_cached_fibers;
+        context->fiber.cache_low_water = std::min(context->fiber.cache_low_water, cache.size());
         HILTI_RT_FIBER_DEBUG("create", fmt("reusing fiber %s from cache", *f.get()));
         return f;
     }
@@ -706,8 +804,14 @@ void detail::Fiber::destroy(std::unique_ptr<detail::Fiber> f) {
     if ( ! context )
         return;
 
+    const auto& config = configuration::detail::unsafeGet();
+
+    if ( config.fiber_cache_trim_interval &&
+         ++context->fiber.completions_since_trim >= config.fiber_cache_trim_interval )
+        _trimCache(&context->fiber);
+
     auto& cache = context->fiber.cache;
-    if ( cache.size() < configuration::detail::unsafeGet().fiber_cache_size ) {
+    if ( cache.size() < config.fiber_cache_size ) {
         HILTI_RT_FIBER_DEBUG("destroy", fmt("putting fiber %s back into cache", *f.get()));
         cache.push_back(std::move(f));
         ++_cached_fibers;
@@ -731,7 +835,12 @@ void detail::Fiber::primeCache() {
 }
 
 void detail::Fiber::reset() {
-    context::detail::get()->fiber.cache.clear();
+    auto* context = context::detail::get();
+    context->fiber.cache.clear();
+    context->fiber.cache_low_water = 0;
+    context->fiber.completions_since_trim = 0;
+    context->fiber.shared_stack_high_water = 0;
+    context->fiber.shared_stack_recent_high_water = 0;
     _total_fibers = 0;
     _current_fibers = 0;
     _cached_fibers = 0;
@@ -813,9 +922,8 @@ void detail::trackStack() {
         return;
 
     if ( fiber->type() == Fiber::Type::IndividualStack || fiber->type() == Fiber::Type::SharedStack ) {
-        // NOLINTNEXTLINE(readability-use-std-min-max)
-        if ( auto size = fiber->stackBuffer().activeSize(); size > detail::Fiber::_max_stack_size )
-            detail::Fiber::_max_stack_size = size;
+        _updateMaximum(&detail::Fiber::_max_stack_size, fiber->stackBuffer().activeSize());
+        fiber->_recordStackUsage(fiber->stackBuffer().liveUsedSize());
     }
 }
 
@@ -84,9 +84,13 @@ void hilti::rt::done() {
         }
     }
 
+    // Reset the current context first, it's owned by the global state. That
+    // way, memory released during destruction, like stream chunks, doesn't
+    // get returned into the pool of a context that's going away.
+    context::detail::set(nullptr);
+
     delete __global_state; // NOLINT (cppcoreguidelines-owning-memory)
     __global_state = nullptr;
-    context::detail::set(nullptr);
 }
 
 bool hilti::rt::isInitialized() { return __global_state && __global_state->runtime_is_initialized; }
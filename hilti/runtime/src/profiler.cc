@@ -1,9 +1,28 @@
 // Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cinttypes>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include <hilti/rt/configuration.h>
+#include <hilti/rt/exception.h>
+#include <hilti/rt/json.h>
 #include <hilti/rt/logging.h>
 #include <hilti/rt/profiler.h>
 #include <hilti/rt/util.h>
@@ -33,35 +52,333 @@ inline static uint64_t _getClock() {
 #endif
 }
 
-void Profiler::_register() const { ++detail::globalState()->profilers[_name].instances; }
+// Helper to read the CPU's timestamp counter, which is much cheaper than
+// going through the clock. Falls back to the clock on platforms without one.
+// Ticks are converted into nanoseconds only when reporting, by relating them
+// to the clock over the runtime of the process.
+inline static uint64_t _getTicks() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return _getClock();
+#endif
+}
+
+namespace {
+
+// Histogram of execution times in ticks, using buckets that grow
+// exponentially with 8 linear sub-buckets per power of two.
+class Histogram {
+public:
+    void record(uint64_t ticks) { _buckets[_index(ticks)].fetch_add(1, std::memory_order_relaxed); }
+
+    // Returns the approximate value below which the given fraction of
+    // recorded values falls.
+    uint64_t percentile(double q, uint64_t total) const {
+        if ( ! total )
+            return 0;
+
+        auto want = std::max(static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))), uint64_t(1));
+
+        uint64_t seen = 0;
+        for ( size_t i = 0; i < _buckets.size(); i++ ) {
+            seen += _buckets[i].load(std::memory_order_relaxed);
+            if ( seen >= want )
+                return _value(i);
+        }
+
+        return _value(_buckets.size() - 1);
+    }
+
+    void reset() {
+        for ( auto& b : _buckets )
+            b.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr unsigned int SubBucketBits = 3;
+    static constexpr size_t NumBuckets = (64 - SubBucketBits + 1) << SubBucketBits;
+
+    static size_t _index(uint64_t v) {
+        if ( v < (1U << SubBucketBits) )
+            return v;
+
+        auto msb = static_cast<unsigned int>(63 - std::countl_zero(v));
+        auto sub = (v >> (msb - SubBucketBits)) & ((1U << SubBucketBits) - 1);
+        return ((msb - SubBucketBits + 1) << SubBucketBits) | sub;
+    }
+
+    // Returns the midpoint of a bucket's range.
+    static uint64_t _value(size_t idx) {
+        if ( idx < (1U << SubBucketBits) )
+            return idx;
+
+        auto msb = (idx >> SubBucketBits) + SubBucketBits - 1;
+        auto sub = idx & ((1U << SubBucketBits) - 1);
+        auto lower = (uint64_t(1) << msb) | (uint64_t(sub) << (msb - SubBucketBits));
+        return lower + ((uint64_t(1) << (msb - SubBucketBits)) / 2);
+    }
+
+    std::array<std::atomic<uint64_t>, NumBuckets> _buckets{};
+};
+
+// Measurements recorded for one slot. All updates are lock-free.
+struct SlotState {
+    std::string name;
+
+    std::atomic<uint64_t> count = 0;     // number of executions, or counter value
+    std::atomic<uint64_t> top_level = 0; // number of top-level executions
+    std::atomic<uint64_t> samples = 0;   // number of top-level executions timed
+    std::atomic<uint64_t> ticks = 0;     // total time of timed executions
+    std::atomic<uint64_t> max_ticks = 0; // longest timed execution
+    std::atomic<uint64_t> volume = 0;
+    std::atomic<bool> have_volume = false;
+    Histogram histogram;
+
+    // Clears all measurements.
+    void reset() {
+        count = 0;
+        top_level = 0;
+        samples = 0;
+        ticks = 0;
+        max_ticks = 0;
+        volume = 0;
+        have_volume = false;
+        histogram.reset();
+    }
+};
+
+// A single timed execution, as recorded for tracing.
+struct SpanRecord {
+    Slot slot;
+    uint64_t thread;
+    uint64_t start;    // ticks
+    uint64_t duration; // ticks
+};
+
+// Returns a small integer identifying the current thread.
+uint64_t threadID() {
+    static std::atomic<uint64_t> next = 0;
+    static thread_local uint64_t id = ++next;
+    return id;
+}
+
+// Process-wide registry of slots. Slots are stored in fixed-size chunks that
+// never move, so that they can be accessed without locking while new ones
+// are being added.
+class Registry {
+public:
+    Registry() {
+        calibrate();
+        period_start = _getTicks();
+    }
+
+    Slot add(std::string_view name) {
+        std::scoped_lock lock(_mutex);
+
+        if ( auto i = _names.find(std::string(name)); i != _names.end() )
+            return i->second;
+
+        auto slot = _size.load(std::memory_order_relaxed);
+        if ( slot >= SlotsPerChunk * MaxChunks )
+            throw RuntimeError("too many profiler slots");
+
+        auto& chunk = _chunks[slot / SlotsPerChunk];
+        if ( ! chunk )
+            chunk = std::make_unique<SlotState[]>(SlotsPerChunk);
+
+        chunk[slot % SlotsPerChunk].name = name;
+        _names.emplace(name, slot);
+        _size.store(slot + 1, std::memory_order_release);
+        return slot;
+    }
+
+    std::optional<Slot> find(const std::string& name) {
+        std::scoped_lock lock(_mutex);
+
+        if ( auto i = _names.find(name); i != _names.end() )
+            return i->second;
+        else
+            return {};
+    }
+
+    SlotState& operator[](Slot slot) { return _chunks[slot / SlotsPerChunk][slot % SlotsPerChunk]; }
+
+    Slot size() const { return _size.load(std::memory_order_acquire); }
+
+    // Clears all measurements, keeping the slots themselves, and starts a
+    // new period. Unless `clear_active` is true, this leaves the state of
+    // executions currently in progress alone.
+    void reset(bool clear_active) {
+        for ( Slot i = 0; i < size(); i++ )
+            (*this)[i].reset();
+
+        if ( clear_active )
+            generation.fetch_add(1, std::memory_order_relaxed);
+
+        next_span = 0;
+        period_start = _getTicks();
+    }
+
+    // Allocates space for recording up to `capacity` executions, discarding
+    // any recorded so far. Zero disables recording.
+    void setTraceCapacity(size_t capacity) {
+        spans = (capacity ? std::make_unique<SpanRecord[]>(capacity) : nullptr);
+        span_capacity = capacity;
+        next_span = 0;
+    }
+
+    // Records an execution for tracing, if enabled.
+    void recordSpan(Slot slot, uint64_t start, uint64_t duration) {
+        if ( ! span_capacity )
+            return;
+
+        if ( auto i = next_span.fetch_add(1, std::memory_order_relaxed); i < span_capacity )
+            spans[i] = SpanRecord{.slot = slot, .thread = threadID(), .start = start, .duration = duration};
+    }
+
+    // Starts a new period for relating ticks to the clock.
+    void calibrate() {
+        _calibration_clock = _getClock();
+        _calibration_ticks = _getTicks();
+    }
+
+    // Converts ticks into nanoseconds.
+    uint64_t toNanoseconds(uint64_t ticks) const {
+        auto elapsed_ticks = _getTicks() - _calibration_ticks;
+        auto elapsed_clock = _getClock() - _calibration_clock;
+
+        if ( ! elapsed_ticks || ! elapsed_clock )
+            return ticks;
+
+        return static_cast<uint64_t>(static_cast<double>(ticks) * static_cast<double>(elapsed_clock) /
+                                     static_cast<double>(elapsed_ticks));
+    }
+
+    unsigned int sample_rate = 1;
+    uint64_t period_start = 0;            // ticks at which the current period started
+    std::atomic<uint64_t> generation = 0; // incremented whenever executions in progress are discarded
+
+    std::unique_ptr<SpanRecord[]> spans; // executions recorded for tracing
+    size_t span_capacity = 0;            // number of executions `spans` has space for
+    std::atomic<size_t> next_span = 0;   // index of next execution to record; may exceed capacity
+
+private:
+    static constexpr Slot SlotsPerChunk = 64;
+    static constexpr Slot MaxChunks = 1024;
+
+    std::mutex _mutex; // protects `_names` and chunk allocation
+    std::unordered_map<std::string, Slot> _names;
+    std::array<std::unique_ptr<SlotState[]>, MaxChunks> _chunks;
+    std::atomic<Slot> _size = 0;
+
+    uint64_t _calibration_clock = 0;
+    uint64_t _calibration_ticks = 0;
+};
+
+// Intentionally leaked so that slots remain valid until the very end of the
+// process, including during static destruction.
+Registry& registry() {
+    static auto* r = new Registry(); // NOLINT(cppcoreguidelines-owning-memory)
+    return *r;
+}
+
+// Returns the current thread's nesting depth of active executions for a
+// slot. We track this per thread so that executions on other threads don't
+// count as nested.
+uint64_t& activeDepth(Slot slot) {
+    static thread_local std::vector<uint64_t> depths;
+    static thread_local uint64_t generation = 0;
+
+    if ( auto g = registry().generation.load(std::memory_order_relaxed); g != generation ) {
+        depths.clear();
+        generation = g;
+    }
+
+    if ( slot >= depths.size() )
+        depths.resize(slot + 1);
+
+    return depths[slot];
+}
+
+void updateMaximum(std::atomic<uint64_t>* m, uint64_t v) {
+    auto current = m->load(std::memory_order_relaxed);
+    while ( v > current && ! m->compare_exchange_weak(current, v, std::memory_order_relaxed) )
+        ;
+}
+
+} // namespace
+
+Slot profiler::slot(std::string_view name) { return registry().add(name); }
+
+bool Profiler::_register() const {
+    auto& s = registry()[_slot];
+
+    // With recursive calls, we only time the top-level.
+    if ( activeDepth(_slot)++ != 0 )
+        return false;
+
+    auto n = s.top_level.fetch_add(1, std::memory_order_relaxed);
+    auto rate = registry().sample_rate;
+    return rate <= 1 || n % rate == 0;
+}
 
 profiler::Measurement Profiler::snapshot(hilti::rt::Optional<uint64_t> volume) {
-    if ( ! detail::globalState()->profiling_enabled )
+    if ( ! rt::detail::unsafeGlobalState()->profiling_enabled )
         return Measurement();
 
     Measurement m;
-    m.time = _getClock();
-    m.volume = volume;
+    m.time = _getTicks();
+    m.volume = std::move(volume);
     return m;
 }
 
+void Profiler::_finish(hilti::rt::Optional<uint64_t> volume) {
+    if ( _timed )
+        record(snapshot(std::move(volume)));
+    else {
+        Measurement end;
+        end.volume = std::move(volume);
+        record(end);
+    }
+}
+
 void Profiler::record(const Measurement& end) {
-    if ( ! detail::globalState()->profiling_enabled )
+    if ( ! rt::detail::unsafeGlobalState()->profiling_enabled )
         return;
 
     if ( ! *this )
         return; // already recorded
 
-    auto& p = detail::globalState()->profilers[_name];
-    assert(p.instances > 0);
+    auto& s = registry()[_slot];
+    s.count.fetch_add(1, std::memory_order_relaxed);
 
-    ++p.m.count;
+    // The execution may have been discarded by a reset in the meantime.
+    if ( auto& depth = activeDepth(_slot); depth > 0 )
+        --depth;
 
-    // With recursive calls, we only time the top-level.
-    if ( p.instances-- == 1 )
-        p.m += (end - _start);
+    auto delta = end - _start;
 
-    _name.clear();
+    if ( _timed ) {
+        s.samples.fetch_add(1, std::memory_order_relaxed);
+        s.ticks.fetch_add(delta.time, std::memory_order_relaxed);
+        updateMaximum(&s.max_ticks, delta.time);
+        s.histogram.record(delta.time);
+        registry().recordSpan(_slot, _start.time, delta.time);
+    }
+
+    if ( delta.volume ) {
+        s.volume.fetch_add(*delta.volume, std::memory_order_relaxed);
+        s.have_volume.store(true, std::memory_order_relaxed);
+    }
+
+    _slot = NoSlot;
 }
 
 void profiler::detail::init() {
@@ -70,56 +387,250 @@ void profiler::detail::init() {
 
     rt::detail::globalState()->profiling_enabled = true;
 
-    auto& p = rt::detail::globalState()->profilers["hilti/total"];
-    p.m = Profiler::snapshot();
+    auto trace_events = configuration::get().profiling_trace_events;
+    if ( ! trace_events && configuration::get().profiling_trace_output )
+        trace_events = 1000000;
+
+    auto& r = registry();
+    r.calibrate();
+    r.reset(true);
+    r.sample_rate = configuration::get().profiling_sample_rate;
+    r.setTraceCapacity(trace_events);
+}
+
+// Writes profiling data to a file through one of the exporters.
+static void exportToFile(const hilti::rt::filesystem::path& path,
+                         void (*exporter)(std::ostream&, const Snapshot&),
+                         const Snapshot& snapshot) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if ( ! out ) {
+        warning(fmt("cannot write profiling results to %s", path.string()));
+        return;
+    }
+
+    exporter(out, snapshot);
 }
 
 void profiler::detail::done() {
     if ( ! rt::detail::globalState()->profiling_enabled )
         return;
 
-    auto& p = rt::detail::globalState()->profilers["hilti/total"];
-    p.m = (Profiler::snapshot() - p.m);
-    ++p.m.count;
-
     report();
+
+    const auto& config = configuration::get();
+    if ( config.profiling_json_output || config.profiling_trace_output ) {
+        auto s = snapshot();
+
+        if ( config.profiling_json_output )
+            exportToFile(*config.profiling_json_output, exportJSON, s);
+
+        if ( config.profiling_trace_output )
+            exportToFile(*config.profiling_trace_output, exportChromeTrace, s);
+    }
+}
+
+void profiler::detail::count(Slot slot, uint64_t n) {
+    if ( slot != NoSlot )
+        registry()[slot].count.fetch_add(n, std::memory_order_relaxed);
+}
+
+// Returns the totals of a slot's executions, with time in nanoseconds
+// extrapolated from the executions sampled.
+static Measurement measurement(const SlotState& s) {
+    auto samples = s.samples.load(std::memory_order_relaxed);
+    auto top_level = s.top_level.load(std::memory_order_relaxed);
+    auto ticks = s.ticks.load(std::memory_order_relaxed);
+
+    if ( samples && samples < top_level )
+        ticks = static_cast<uint64_t>(static_cast<double>(ticks) * static_cast<double>(top_level) /
+                                      static_cast<double>(samples));
+
+    Measurement m;
+    m.count = s.count.load(std::memory_order_relaxed);
+    m.time = registry().toNanoseconds(ticks);
+
+    if ( s.have_volume.load(std::memory_order_relaxed) )
+        m.volume = s.volume.load(std::memory_order_relaxed);
+
+    return m;
+}
+
+// Returns the distribution of a slot's execution times in nanoseconds.
+static Latencies latencies(const SlotState& s) {
+    const auto& r = registry();
+
+    Latencies l;
+    l.samples = s.samples.load(std::memory_order_relaxed);
+    l.p50 = r.toNanoseconds(s.histogram.percentile(0.5, l.samples));
+    l.p99 = r.toNanoseconds(s.histogram.percentile(0.99, l.samples));
+    l.max = r.toNanoseconds(s.max_ticks.load(std::memory_order_relaxed));
+    return l;
 }
 
 hilti::rt::Optional<Measurement> profiler::get(const std::string& name) {
-    const auto& profilers = rt::detail::globalState()->profilers;
-    if ( auto i = profilers.find(name); i != profilers.end() )
-        return i->second.m;
+    if ( auto slot = registry().find(name) )
+        return measurement(registry()[*slot]);
     else
         return {};
 }
 
-void profiler::report() {
-    static const auto* const fmt_header = "#%-49s %10s %10s %10s %10s %15s\n";
-    static const auto* const fmt_data = "%-50s %10" PRIu64 " %10" PRIu64 " %10.2f %10.2f %15s\n";
+hilti::rt::Optional<Latencies> profiler::latencies(const std::string& name) {
+    if ( auto slot = registry().find(name) )
+        return ::latencies(registry()[*slot]);
+    else
+        return {};
+}
 
-    const auto& profilers = rt::detail::globalState()->profilers;
+Snapshot profiler::snapshot() {
+    auto& r = registry();
 
-    std::cerr << "#\n# Profiling results\n#\n";
-    std::cerr << fmt(fmt_header, "name", "count", "time", "avg-%", "total-%", "volume");
+    Snapshot snapshot;
+    snapshot.time = r.toNanoseconds(_getTicks() - r.period_start);
+
+    for ( Slot i = 0; i < r.size(); i++ ) {
+        const auto& s = r[i];
+        auto m = measurement(s);
+
+        if ( m.count == 0 )
+            continue;
+
+        snapshot.blocks.push_back(Summary{.name = s.name, .measurement = std::move(m), .latencies = ::latencies(s)});
+    }
+
+    // The period itself is reported as a block covering everything.
+    if ( rt::detail::unsafeGlobalState()->profiling_enabled ) {
+        Summary total{.name = "hilti/total"};
+        total.measurement.count = 1;
+        total.measurement.time = snapshot.time;
+        total.latencies = Latencies{.samples = 1, .p50 = snapshot.time, .p99 = snapshot.time, .max = snapshot.time};
+        snapshot.blocks.push_back(std::move(total));
+    }
+
+    std::ranges::sort(snapshot.blocks, [](const auto& a, const auto& b) { return a.name < b.name; });
+
+    auto recorded = std::min(r.next_span.load(std::memory_order_relaxed), r.span_capacity);
+    snapshot.dropped_spans = r.next_span.load(std::memory_order_relaxed) - recorded;
+    snapshot.spans.reserve(recorded);
+
+    for ( size_t i = 0; i < recorded; i++ ) {
+        const auto& x = r.spans[i];
+
+        // Executions started before the period began get clamped to its beginning.
+        auto start = (x.start > r.period_start ? r.toNanoseconds(x.start - r.period_start) : 0);
+
+        snapshot.spans.push_back(Span{.name = r[x.slot].name,
+                                      .thread = x.thread,
+                                      .start = start,
+                                      .duration = r.toNanoseconds(x.duration)});
+    }
+
+    return snapshot;
+}
+
+void profiler::reset() { registry().reset(false); }
+
+void profiler::exportJSON(std::ostream& out, const Snapshot& snapshot) {
+    auto blocks = nlohmann::json::array();
 
-    std::set<std::string> names;
-    for ( const auto& [name, _] : profilers )
-        names.insert(name);
+    for ( const auto& b : snapshot.blocks ) {
+        nlohmann::json block = {
+            {"name", b.name},
+            {"count", b.measurement.count},
+            {"time", b.measurement.time},
+            {"volume", nullptr},
+        };
 
-    auto total_time = static_cast<double>(profilers.at("hilti/total").m.time);
+        if ( b.measurement.volume )
+            block["volume"] = *b.measurement.volume;
 
-    for ( const auto& name : names ) {
-        const auto& p = profilers.at(name).m;
+        if ( b.latencies.samples ) {
+            block["samples"] = b.latencies.samples;
+            block["p50"] = b.latencies.p50;
+            block["p99"] = b.latencies.p99;
+            block["max"] = b.latencies.max;
+        }
 
-        if ( p.count == 0 )
+        blocks.push_back(std::move(block));
+    }
+
+    nlohmann::json j = {{"time", snapshot.time}, {"blocks", std::move(blocks)}};
+    out << j.dump(4) << '\n';
+}
+
+void profiler::exportChromeTrace(std::ostream& out, const Snapshot& snapshot) {
+    // Returns a name's first path component for use as the event's category.
+    auto category = [](std::string_view name) { return std::string(name.substr(0, name.find('/'))); };
+
+    auto events = nlohmann::json::array();
+    events.push_back({{"name", "process_name"}, {"ph", "M"}, {"pid", 1}, {"args", {{"name", "hilti"}}}});
+
+    // Trace timestamps are in microseconds.
+    for ( const auto& s : snapshot.spans )
+        events.push_back({{"name", std::string(s.name)},
+                          {"cat", category(s.name)},
+                          {"ph", "X"},
+                          {"ts", static_cast<double>(s.start) / 1e3},
+                          {"dur", static_cast<double>(s.duration) / 1e3},
+                          {"pid", 1},
+                          {"tid", s.thread}});
+
+    // Pure event counters don't have any executions, report their final values.
+    for ( const auto& b : snapshot.blocks ) {
+        if ( b.latencies.samples )
             continue;
 
+        events.push_back({{"name", b.name},
+                          {"cat", category(b.name)},
+                          {"ph", "C"},
+                          {"ts", static_cast<double>(snapshot.time) / 1e3},
+                          {"pid", 1},
+                          {"args", {{"count", b.measurement.count}}}});
+    }
+
+    nlohmann::json j = {{"traceEvents", std::move(events)},
+                        {"displayTimeUnit", "ns"},
+                        {"otherData", {{"dropped_events", snapshot.dropped_spans}}}};
+
+    out << j.dump() << '\n';
+}
+
+void profiler::report() {
+    static const auto* const fmt_header = "#%-49s %10s %10s %10s %10s %15s %10s %10s %10s\n";
+    static const auto* const fmt_data = "%-50s %10" PRIu64 " %10" PRIu64 " %10.2f %10.2f %15s %10s %10s %10s\n";
+
+    std::cerr << "#\n# Profiling results\n#\n";
+    std::cerr << fmt(fmt_header, "name", "count", "time", "avg-%", "total-%", "volume", "p50", "p99", "max");
+
+    auto s = snapshot();
+    auto total_time = (s.time ? static_cast<double>(s.time) : 1.0);
+
+    for ( const auto& b : s.blocks ) {
+        const auto& p = b.measurement;
         auto percent = static_cast<double>(p.time) * 100.0 / total_time;
 
         std::string volume = "-";
         if ( p.volume )
             volume = fmt("%" PRIu64, *p.volume);
 
-        std::cerr << fmt(fmt_data, name, p.count, p.time, percent / static_cast<double>(p.count), percent, volume);
+        std::string p50 = "-";
+        std::string p99 = "-";
+        std::string max = "-";
+
+        if ( b.latencies.samples ) {
+            p50 = fmt("%" PRIu64, b.latencies.p50);
+            p99 = fmt("%" PRIu64, b.latencies.p99);
+            max = fmt("%" PRIu64, b.latencies.max);
+        }
+
+        std::cerr << fmt(fmt_data,
+                         b.name,
+                         p.count,
+                         p.time,
+                         percent / static_cast<double>(p.count),
+                         percent,
+                         volume,
+                         p50,
+                         p99,
+                         max);
     }
 }
@@ -6,7 +6,9 @@
 #include <cstdint>
 
 #include <hilti/rt/context.h>
+#include <hilti/rt/exception.h>
 #include <hilti/rt/init.h>
+#include <hilti/rt/result.h>
 #include <hilti/rt/test/utils.h>
 #include <hilti/rt/threading.h>
 
@@ -68,4 +70,41 @@ TEST_CASE("execute") {
     CHECK_EQ(count, 1U); // Function was executed exactly once.
 }
 
+TEST_CASE("executeDirectly") {
+    init(); // Noop if already initialized.
+
+    SUBCASE("result") {
+        auto r = context::executeDirectly([](int a, int b) { return a + b; }, 40, 2);
+        CHECK(r);
+        REQUIRE(r.hasResult());
+        CHECK_EQ(r.get<int>(), 42);
+        CHECK_EQ(context::detail::get()->resumable, nullptr);
+    }
+
+    SUBCASE("cannot yield") {
+        CHECK_THROWS_WITH_AS(context::executeDirectly([]() {
+                                 detail::yield();
+                                 return Nothing();
+                             }),
+                             "'yield' in non-suspendable context",
+                             const RuntimeError&);
+    }
+
+    SUBCASE("inside fiber") {
+        // Inside a fiber, the direct call must not be able to yield the
+        // surrounding fiber either.
+        auto r = context::execute([]() {
+            auto* outer = context::detail::get()->resumable;
+            REQUIRE(outer);
+
+            auto inner = context::executeDirectly([]() { return context::detail::get()->resumable; });
+            CHECK_EQ(inner.get<resumable::Handle*>(), nullptr);
+            CHECK_EQ(context::detail::get()->resumable, outer);
+            return 1;
+        });
+
+        CHECK(r);
+    }
+}
+
 TEST_SUITE_END();
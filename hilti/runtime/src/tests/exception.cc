@@ -2,6 +2,7 @@
 
 #include <doctest/doctest.h>
 
+#include <cinttypes>
 #include <cstddef>
 #include <string>
 #include <utility>
@@ -84,6 +85,35 @@ TEST_CASE("location") {
     CHECK_EQ(Exception("description", "location.h").location(), "location.h");
 }
 
+TEST_CASE("deferred") {
+    static int renders = 0;
+    renders = 0;
+
+    exception::Deferred d;
+    d.render = [](const exception::Deferred& x) {
+        ++renders;
+        return fmt("%s %d %" PRIu64 " %s", x.message, x.code, x.values[0], x.data[0]);
+    };
+    d.code = 42;
+    d.message = "message";
+    d.location = "location.h";
+    d.values[0] = 1;
+    d.data[0] = "data";
+
+    auto e = RuntimeError(std::move(d));
+    CHECK_EQ(renders, 0);
+    CHECK_EQ(e.location(), "location.h");
+    CHECK_EQ(renders, 0);
+
+    CHECK_EQ(std::string(e.what()), "message 42 1 data (location.h)");
+    CHECK_EQ(e.description(), "message 42 1 data");
+    CHECK_EQ(renders, 1);
+
+    auto copy = e;
+    CHECK_EQ(to_string(copy), "<exception: message 42 1 data (location.h)>");
+    CHECK_EQ(renders, 1);
+}
+
 TEST_CASE("DisableAbortOnExceptions") {
     REQUIRE_FALSE(detail::globalState()->disable_abort_on_exceptions);
 
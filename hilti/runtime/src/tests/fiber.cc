@@ -290,6 +290,60 @@ TEST_CASE("prime-cache") {
     REQUIRE(stats.cached == hilti::rt::configuration::get().fiber_cache_size);
 }
 
+TEST_CASE("stack-release") {
+    hilti::rt::init();
+    hilti::rt::detail::Fiber::reset(); // reset cache and counters
+
+    // Trim the cache after every fiber. Change the configuration directly as
+    // the runtime is already initialized, which `configuration::set()` rejects.
+    auto& config = *hilti::rt::configuration::detail::__configuration;
+    const auto old_trim_interval = config.fiber_cache_trim_interval;
+    config.fiber_cache_trim_interval = 1;
+
+    // Use well beyond what gets retained for idle fibers, and then check that
+    // reused fibers can still go that deep afterwards.
+    auto depth = 4 * config.fiber_stack_retain_size;
+
+    auto deep = [depth](hilti::rt::resumable::Handle* r) {
+        auto* xs = static_cast<volatile char*>(alloca(depth));
+        xs[0] = 1;
+        xs[depth - 1] = 1;
+        r->yield();
+        return hilti::rt::Nothing();
+    };
+
+    auto shallow = [](hilti::rt::resumable::Handle* r) {
+        r->yield();
+        return hilti::rt::Nothing();
+    };
+
+    for ( auto i = 0; i < 3; i++ ) {
+        // Get two fibers into the cache, then reuse just one of them so that
+        // the other stays idle and gets its stack memory released.
+        hilti::rt::Resumable r1(deep);
+        hilti::rt::Resumable r2(deep);
+        r1.run();
+        r2.run();
+        r1.resume();
+        r2.resume();
+        REQUIRE(r1);
+        REQUIRE(r2);
+
+        for ( auto j = 0; j < 3; j++ ) {
+            hilti::rt::Resumable r(shallow);
+            r.run();
+            r.resume();
+            REQUIRE(r);
+        }
+    }
+
+    auto stats = hilti::rt::detail::Fiber::statistics();
+    CHECK_EQ(stats.total, 2);
+    CHECK_EQ(stats.cached, 2);
+
+    config.fiber_cache_trim_interval = old_trim_interval;
+}
+
 TEST_CASE("copy-arg") {
     hilti::rt::init();
 
@@ -3,11 +3,14 @@
 #include <doctest/doctest.h>
 
 #include <memory>
+#include <sstream>
 #include <utility>
 
 #include <hilti/rt/configuration.h>
+#include <hilti/rt/context.h>
 #include <hilti/rt/global-state.h>
 #include <hilti/rt/hilti.h>
+#include <hilti/rt/test/utils.h>
 #include <hilti/rt/types/bytes.h>
 #include <hilti/rt/types/real.h>
 
@@ -49,6 +52,23 @@ TEST_CASE("print") {
         print(0.5, nullptr, false);
         CHECK_EQ(cout.str(), "\\x00\\x010.5");
     }
+
+    SUBCASE("context stream") {
+        TestCout cout;
+        std::stringstream context_cout;
+
+        Context context(42);
+        test::TestContext _(&context);
+
+        context.cout = &context_cout;
+        print(0.5, nullptr, true);
+
+        context.cout = nullptr;
+        print(1.5, nullptr, true);
+
+        CHECK_EQ(context_cout.str(), "0.5\n");
+        CHECK_EQ(cout.str(), "1.5\n");
+    }
 }
 
 TEST_SUITE_END();
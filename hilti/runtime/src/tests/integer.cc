@@ -10,6 +10,7 @@
 #include <hilti/rt/safe-int.h>
 #include <hilti/rt/types/bytes.h>
 #include <hilti/rt/types/integer.h>
+#include <hilti/rt/types/stream.h>
 #include <hilti/rt/types/string.h>
 #include <hilti/rt/types/tuple.h>
 
@@ -232,4 +233,42 @@ TEST_CASE("unpack") {
              make_result64(0x0102030405060708, ""_b));
 }
 
+TEST_CASE("unpackAndAdvance") {
+    SUBCASE("contiguous") {
+        auto s = Stream("\x01\x02\x03\x04\x05\x06\x07\x08\x09"_b);
+        auto v = s.view();
+
+        CHECK_EQ(integer::unpackAndAdvance<uint16_t>(v, ByteOrder::Big), 0x0102);
+        CHECK_EQ(v.offset(), 2);
+        CHECK_EQ(integer::unpackAndAdvance<uint16_t>(v, ByteOrder::Little), 0x0403);
+        CHECK_EQ(integer::unpackAndAdvance<int8_t>(v, ByteOrder::Network), 5);
+        CHECK_EQ(integer::unpackAndAdvance<uint32_t>(v, ByteOrder::Big), 0x06070809);
+        CHECK(v.isEmpty());
+    }
+
+    SUBCASE("across chunks") {
+        auto s = Stream();
+        s.append("\x01\x02\x03"_b);
+        s.append("\x04\x05\x06\x07\x08\x09"_b);
+        auto v = s.view().advance(1);
+
+        CHECK_EQ(integer::unpackAndAdvance<uint64_t>(v, ByteOrder::Big), 0x0203040506070809);
+        CHECK(v.isEmpty());
+    }
+
+    SUBCASE("signed") {
+        auto s = Stream("\xff\xfe"_b);
+        auto v = s.view();
+        CHECK_EQ(integer::unpackAndAdvance<int16_t>(v, ByteOrder::Little), -257);
+    }
+
+    SUBCASE("errors") {
+        auto s = Stream("\x01"_b);
+        auto v = s.view();
+        CHECK_THROWS_WITH(integer::unpackAndAdvance<uint16_t>(v, ByteOrder::Big), "insufficient data to unpack integer");
+        CHECK_THROWS_WITH(integer::unpackAndAdvance<uint8_t>(v, ByteOrder::Undef), "undefined byte order");
+        CHECK_EQ(v.offset(), 0);
+    }
+}
+
 TEST_SUITE_END();
@@ -3,11 +3,15 @@
 #include <doctest/doctest.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include <hilti/rt/configuration.h>
 #include <hilti/rt/global-state.h>
 #include <hilti/rt/init.h>
+#include <hilti/rt/json.h>
 #include <hilti/rt/profiler.h>
 
 using namespace hilti::rt;
@@ -42,4 +46,255 @@ TEST_CASE("measurement") {
     detail::globalState()->profiling_enabled = old_profiling;
 }
 
+TEST_CASE("count") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+
+    detail::globalState()->profiling_enabled = false;
+    profiler::count("abc");
+    CHECK_FALSE(profiler::get("abc"));
+
+    detail::globalState()->profiling_enabled = true;
+    profiler::count("abc");
+    profiler::count("abc", 4);
+
+    auto m = profiler::get("abc");
+    REQUIRE(m);
+    CHECK_EQ(m->count, 5);
+    CHECK_EQ(m->time, 0);
+
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+TEST_CASE("slot") {
+    auto s1 = profiler::slot("slot-test");
+    CHECK_EQ(profiler::slot("slot-test"), s1);
+    CHECK_NE(profiler::slot("slot-test-2"), s1);
+    CHECK_NE(s1, profiler::NoSlot);
+}
+
+TEST_CASE("latencies") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+    detail::globalState()->profiling_enabled = true;
+
+    CHECK_FALSE(profiler::latencies("latencies-test"));
+
+    auto slot = profiler::slot("latencies-test");
+
+    for ( int i = 0; i < 10; i++ ) {
+        auto p = profiler::start(slot);
+        ::usleep(10);
+        profiler::stop(p);
+    }
+
+    auto l = profiler::latencies("latencies-test");
+    REQUIRE(l);
+    CHECK_EQ(l->samples, 10);
+    CHECK_GT(l->p50, 0);
+    CHECK_LE(l->p50, l->p99);
+    CHECK_GT(l->max, 0);
+
+    auto m = profiler::get("latencies-test");
+    REQUIRE(m);
+    CHECK_EQ(m->count, 10);
+
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+TEST_CASE("nesting") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+    detail::globalState()->profiling_enabled = true;
+
+    auto slot = profiler::slot("nesting-test");
+
+    // Recursive executions are timed only at the top level.
+    {
+        auto outer = profiler::start(slot);
+        auto inner = profiler::start(slot);
+        profiler::stop(inner);
+        profiler::stop(outer);
+    }
+
+    auto l = profiler::latencies("nesting-test");
+    REQUIRE(l);
+    CHECK_EQ(l->samples, 1);
+
+    // An execution in progress on another thread doesn't make ours nested.
+    {
+        auto outer = profiler::start(slot);
+        std::thread([slot]() {
+            auto p = profiler::start(slot);
+            profiler::stop(p);
+        }).join();
+        profiler::stop(outer);
+    }
+
+    l = profiler::latencies("nesting-test");
+    REQUIRE(l);
+    CHECK_EQ(l->samples, 3);
+
+    auto m = profiler::get("nesting-test");
+    REQUIRE(m);
+    CHECK_EQ(m->count, 4);
+
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+TEST_CASE("sampling") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+
+    // Change the configuration directly as the runtime may already be initialized, which `configuration::set()`
+    // rejects.
+    configuration::get();
+    auto& cfg = *configuration::detail::__configuration;
+    const auto old_enable_profiling = cfg.enable_profiling;
+    cfg.enable_profiling = true;
+    cfg.profiling_sample_rate = 4;
+    profiler::detail::init();
+
+    for ( int i = 0; i < 8; i++ ) {
+        auto p = profiler::start("sampling-test");
+        profiler::stop(p, 100);
+    }
+
+    auto m = profiler::get("sampling-test");
+    REQUIRE(m);
+    CHECK_EQ(m->count, 8);
+    REQUIRE(m->volume);
+    CHECK_EQ(*m->volume, 800);
+
+    auto l = profiler::latencies("sampling-test");
+    REQUIRE(l);
+    CHECK_EQ(l->samples, 2);
+
+    // Restore the default rate for subsequent tests.
+    cfg.profiling_sample_rate = 1;
+    profiler::detail::init();
+
+    cfg.enable_profiling = old_enable_profiling;
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+// Returns the summary of a block in a snapshot, or null if not included.
+static const profiler::Summary* findBlock(const profiler::Snapshot& s, const std::string& name) {
+    auto i = std::ranges::find_if(s.blocks, [&](const auto& b) { return b.name == name; });
+    return i != s.blocks.end() ? &*i : nullptr;
+}
+
+TEST_CASE("snapshot") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+    detail::globalState()->profiling_enabled = true;
+
+    profiler::reset();
+
+    for ( int i = 0; i < 3; i++ ) {
+        auto p = profiler::start("snapshot-test");
+        profiler::stop(p);
+    }
+
+    auto s = profiler::snapshot();
+    CHECK_GT(s.time, 0);
+    CHECK(std::ranges::is_sorted(s.blocks, [](const auto& x, const auto& y) { return x.name < y.name; }));
+
+    const auto* b = findBlock(s, "snapshot-test");
+    REQUIRE(b);
+    CHECK_EQ(b->measurement.count, 3);
+    CHECK_EQ(b->latencies.samples, 3);
+
+    CHECK(findBlock(s, "hilti/total"));
+
+    profiler::reset();
+    s = profiler::snapshot();
+    CHECK_FALSE(findBlock(s, "snapshot-test"));
+
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+TEST_CASE("export-json") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+    detail::globalState()->profiling_enabled = true;
+
+    profiler::reset();
+
+    auto p = profiler::start("export-json-test", 10);
+    profiler::stop(p, 52);
+    profiler::count("export-json-counter", 7);
+
+    std::stringstream out;
+    profiler::exportJSON(out, profiler::snapshot());
+
+    auto j = nlohmann::json::parse(out.str());
+    REQUIRE(j["blocks"].is_array());
+
+    bool seen_block = false;
+    bool seen_counter = false;
+
+    for ( const auto& b : j["blocks"] ) {
+        if ( b["name"] == "export-json-test" ) {
+            seen_block = true;
+            CHECK_EQ(b["count"], 1);
+            CHECK_EQ(b["volume"], 42);
+            CHECK_EQ(b["samples"], 1);
+            CHECK(b.contains("p99"));
+        }
+
+        if ( b["name"] == "export-json-counter" ) {
+            seen_counter = true;
+            CHECK_EQ(b["count"], 7);
+            CHECK(b["volume"].is_null());
+            CHECK_FALSE(b.contains("samples"));
+        }
+    }
+
+    CHECK(seen_block);
+    CHECK(seen_counter);
+
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
+TEST_CASE("export-chrome-trace") {
+    auto old_profiling = hilti::rt::detail::globalState()->profiling_enabled;
+
+    // Change the configuration directly as the runtime may already be initialized, which `configuration::set()`
+    // rejects.
+    configuration::get();
+    auto& cfg = *configuration::detail::__configuration;
+    const auto old_enable_profiling = cfg.enable_profiling;
+    cfg.enable_profiling = true;
+    cfg.profiling_trace_events = 2;
+    profiler::detail::init();
+
+    for ( int i = 0; i < 3; i++ ) {
+        auto p = profiler::start("trace-test/block");
+        profiler::stop(p);
+    }
+
+    auto s = profiler::snapshot();
+    CHECK_EQ(s.spans.size(), 2);
+    CHECK_EQ(s.dropped_spans, 1);
+    CHECK_EQ(s.spans[0].name, "trace-test/block");
+
+    std::stringstream out;
+    profiler::exportChromeTrace(out, s);
+
+    auto j = nlohmann::json::parse(out.str());
+    REQUIRE(j["traceEvents"].is_array());
+    CHECK_EQ(j["otherData"]["dropped_events"], 1);
+
+    const auto& events = j["traceEvents"];
+    auto spans = std::count_if(events.begin(), events.end(), [](const auto& e) { return e["ph"] == "X"; });
+    CHECK_EQ(spans, 2);
+
+    for ( const auto& e : j["traceEvents"] ) {
+        if ( e["ph"] == "X" )
+            CHECK_EQ(e["cat"], "trace-test");
+    }
+
+    // Restore the default of not recording executions.
+    cfg.profiling_trace_events = 0;
+    profiler::detail::init();
+
+    cfg.enable_profiling = old_enable_profiling;
+    detail::globalState()->profiling_enabled = old_profiling;
+}
+
 TEST_SUITE_END();
@@ -2,8 +2,17 @@
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <hilti/rt/configuration.h>
 #include <hilti/rt/exception.h>
 #include <hilti/rt/extension-points.h>
+#include <hilti/rt/global-state.h>
+#include <hilti/rt/profiler.h>
 #include <hilti/rt/safe-int.h>
 #include <hilti/rt/types/bytes.h>
 #include <hilti/rt/types/integer.h>
@@ -204,6 +213,45 @@ TEST_SUITE_END();
 
 TEST_SUITE_BEGIN("MatchState");
 
+TEST_CASE("findCandidate") {
+    auto find_candidate = [](const RegExp& re, std::string_view data) { return re.findCandidate(data.data(), data.size()); };
+
+    SUBCASE("literal prefix") {
+        const auto re = RegExp("abc[0-9]"_p);
+        CHECK_EQ(find_candidate(re, "xxxxabc1"), 4);
+        CHECK_EQ(find_candidate(re, "abxabc1"), 3);
+        CHECK_EQ(find_candidate(re, "xxxxxxab"), 6); // may still complete
+        CHECK_EQ(find_candidate(re, "xxxxxxxx"), 8);
+        CHECK_EQ(find_candidate(re, ""), 0);
+    }
+
+    SUBCASE("first bytes") {
+        const auto re = RegExp({"foo"_p, "bar"_p, "[0-9]+x"_p});
+        CHECK_EQ(find_candidate(re, "xxbarfoo"), 2);
+        CHECK_EQ(find_candidate(re, "xxxxfoo"), 4);
+        CHECK_EQ(find_candidate(re, "xxx7"), 3);
+        CHECK_EQ(find_candidate(re, "xxxxxxx"), 7);
+    }
+
+    SUBCASE("case-insensitive") {
+        const auto re = RegExp(regexp::Pattern("abc", true));
+        CHECK_EQ(find_candidate(re, "xxABc"), 2);
+        CHECK_EQ(find_candidate(re, "xxaBC"), 2);
+    }
+
+    SUBCASE("no prefilter") {
+        // Matches the empty string, so may start anywhere.
+        CHECK_EQ(find_candidate(RegExp("a*"_p), "xyz"), 0);
+        CHECK_EQ(find_candidate(RegExp(".bc"_p), "xyz"), 0);
+    }
+
+    SUBCASE("consistent with find") {
+        const auto re = RegExp({"GET /"_p, "POST /"_p}, regexp::Flags{.no_sub = 1});
+        CHECK_EQ(re.find("xxxxxxxxxxPOST /index"_b), tuple::make(2, "POST /"_b));
+        CHECK_EQ(re.find("xxxxxxxxxxGET"_b), tuple::make(-1, ""_b));
+    }
+}
+
 TEST_CASE("construct") {
     CHECK_THROWS_WITH_AS(RegExp().tokenMatcher(), "trying to match empty pattern set", const PatternError&);
 }
@@ -464,6 +512,166 @@ TEST_CASE("caching") {
     CHECK_NE(re1a.jrx(), re4.jrx());
 }
 
+TEST_CASE("cache eviction") {
+    // Shrink the cache directly as the runtime may already be initialized, which `configuration::set()` rejects.
+    configuration::get();
+    auto& cfg = *configuration::detail::__configuration;
+    const auto old_cache_size = cfg.compiled_regexp_cache_size;
+    cfg.compiled_regexp_cache_size = 2;
+
+    const auto old_profiling = detail::globalState()->profiling_enabled;
+    detail::globalState()->profiling_enabled = true;
+
+    auto& cache = detail::globalState()->compiled_regexp_cache.entries;
+    detail::globalState()->compiled_regexp_cache.clear();
+
+    auto is_cached = [&](const std::string& pattern) {
+        return std::ranges::any_of(cache, [&](const auto& x) { return x.first.find(pattern) != std::string::npos; });
+    };
+
+    auto counter = [](const std::string& name) -> uint64_t {
+        auto m = profiler::get(name);
+        return m ? m->count : 0;
+    };
+
+    const auto hits = counter("hilti/regexp/compiled-cache-hits");
+    const auto misses = counter("hilti/regexp/compiled-cache-misses");
+    const auto evictions = counter("hilti/regexp/compiled-cache-evictions");
+    const auto bypasses = counter("hilti/regexp/compiled-cache-bypasses");
+
+    SUBCASE("in use") {
+        const auto re1 = RegExp("evict1"_p);
+        const auto re2 = RegExp("evict2"_p);
+        const auto re3 = RegExp("evict3"_p);
+
+        // Both cached entries are still referenced, so the third can't replace either.
+        CHECK_EQ(cache.size(), 2);
+        CHECK(is_cached("evict1"));
+        CHECK(is_cached("evict2"));
+        CHECK_FALSE(is_cached("evict3"));
+        CHECK_GT(re3.match("evict3"_b), 0);
+        CHECK_NE(RegExp("evict3"_p).jrx(), re3.jrx());
+
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-misses"), misses + 4);
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-bypasses"), bypasses + 2);
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-evictions"), evictions);
+    }
+
+    SUBCASE("least recently used") {
+        CHECK(RegExp("evict1"_p).jrx());
+        CHECK(RegExp("evict2"_p).jrx());
+        CHECK(RegExp("evict1"_p).jrx());
+        CHECK(RegExp("evict3"_p).jrx());
+
+        CHECK_EQ(cache.size(), 2);
+        CHECK(is_cached("evict1"));
+        CHECK_FALSE(is_cached("evict2"));
+        CHECK(is_cached("evict3"));
+
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-hits"), hits + 1);
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-misses"), misses + 3);
+        CHECK_EQ(counter("hilti/regexp/compiled-cache-evictions"), evictions + 1);
+    }
+
+    detail::globalState()->compiled_regexp_cache.clear();
+    detail::globalState()->profiling_enabled = old_profiling;
+    cfg.compiled_regexp_cache_size = old_cache_size;
+}
+
+TEST_CASE("concurrent use") {
+    constexpr int num_threads = 8;
+    constexpr int num_rounds = 500;
+
+    std::atomic<int> failures = 0;
+    std::vector<std::thread> threads;
+
+    SUBCASE("shared instance") {
+        // All threads must end up with the same compiled instance, matching
+        // concurrently against the same automaton.
+        const regexp::Patterns patterns = {"abc"_p, "(foo|bar)+x"_p, "[0-9]+;"_p};
+        const auto shared = RegExp(patterns, {.no_sub = true});
+
+        for ( int t = 0; t < num_threads; t++ ) {
+            threads.emplace_back([&]() {
+                for ( int i = 0; i < num_rounds; i++ ) {
+                    const auto re = RegExp(patterns, {.no_sub = true});
+
+                    if ( ! (re == shared) || re.jrx() != shared.jrx() || re.jrx() == nullptr )
+                        ++failures;
+
+                    if ( re.match("abc"_b) != 1 || re.match("barfoox"_b) != 2 || re.match("xyz"_b) != 0 )
+                        ++failures;
+
+                    auto ms = re.tokenMatcher();
+                    if ( ms.advance("foo"_b, false) != tuple::make(-1, 3) ||
+                         ms.advance("barxyz"_b, true) != tuple::make(2, 4) )
+                        ++failures;
+
+                    if ( re.find("---1234;--"_b) != tuple::make(3, "1234;"_b) )
+                        ++failures;
+                }
+            });
+        }
+
+        for ( auto& t : threads )
+            t.join();
+
+        CHECK_EQ(failures, 0);
+    }
+
+    SUBCASE("eviction") {
+        // Keep the cache small so that threads keep evicting each other's entries.
+        configuration::get();
+        auto& cfg = *configuration::detail::__configuration;
+        const auto old_cache_size = cfg.compiled_regexp_cache_size;
+        cfg.compiled_regexp_cache_size = 4;
+
+        for ( int t = 0; t < num_threads; t++ ) {
+            threads.emplace_back([&, t]() {
+                for ( int i = 0; i < num_rounds; i++ ) {
+                    auto x = fmt("t%d-%d", t, i % 7);
+                    const auto re = RegExp(regexp::Pattern(x), {.no_sub = true});
+
+                    if ( re.match(Bytes(x)) != 1 || re.tokenMatcher().advance(Bytes(x), true) != tuple::make(1, 4) )
+                        ++failures;
+                }
+            });
+        }
+
+        for ( auto& t : threads )
+            t.join();
+
+        CHECK_EQ(failures, 0);
+        CHECK_LE(detail::globalState()->compiled_regexp_cache.entries.size(), 4);
+
+        cfg.compiled_regexp_cache_size = old_cache_size;
+    }
+}
+
+TEST_CASE("automata") {
+    const auto re = RegExp("a+b"_p, {.no_sub = true});
+    CHECK_EQ(re.jrx(), re.jrx());
+
+    // A different thread matches against the same automaton.
+    jrx_regex_t* other = nullptr;
+    int32_t rc = 0;
+    std::thread([&]() {
+        other = re.jrx();
+        rc = re.match("aaab"_b);
+    }).join();
+
+    CHECK_EQ(other, re.jrx());
+    CHECK_EQ(rc, 1);
+    CHECK_EQ(re.match("aaab"_b), 1);
+
+    // A match state can be resumed on a different thread.
+    auto ms = re.tokenMatcher();
+    CHECK_EQ(ms.advance("aa"_b, false), tuple::make(-1, 2));
+    Tuple<int32_t, int64_t> resumed;
+    std::thread([&]() { resumed = ms.advance("b"_b, true); }).join();
+    CHECK_EQ(resumed, tuple::make(1, 1));
+}
+
 TEST_CASE("validation") {
     CHECK("abc"_p.validate().hasValue());
     CHECK_EQ("abc("_p.validate().error().description(), "error compiling pattern 'abc(': bad pattern: syntax error");
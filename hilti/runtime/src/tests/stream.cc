@@ -818,6 +818,149 @@ TEST_CASE("Trim empty") {
     CHECK_EQ(x.numberOfChunks(), 0);
 }
 
+TEST_CASE("Many chunks") {
+    // Chunks of varying sizes, with each byte encoding its chunk's index.
+    Stream x;
+    std::string data;
+    for ( int i = 0; i < 1000; i++ ) {
+        auto chunk = std::string((i % 7) + 1, static_cast<char>(i % 256));
+        x.append(chunk.data(), chunk.size());
+        data += chunk;
+    }
+
+    REQUIRE_EQ(x.numberOfChunks(), 1000);
+
+    // Access in reverse so that lookups cannot be served from hints.
+    for ( auto i = data.size(); i > 0; i-- )
+        CHECK_EQ(*x.at(i - 1), static_cast<Byte>(data[i - 1]));
+
+    // Trim away chunks one by one, while checking lookups still work.
+    uint64_t offset = 0;
+    for ( int i = 0; i < 1000; i++ ) {
+        offset += static_cast<uint64_t>((i % 7) + 1);
+        x.trim(x.at(offset));
+        REQUIRE_EQ(x.numberOfChunks(), 1000 - i - 1);
+
+        if ( offset < data.size() ) {
+            CHECK_EQ(*x.at(offset), static_cast<Byte>(data[offset]));
+            CHECK_EQ(*x.at(data.size() - 1), static_cast<Byte>(data.back()));
+        }
+    }
+
+    // Chain remains usable after having been trimmed completely.
+    x.append("abc"_b);
+    CHECK_EQ(x.numberOfChunks(), 1);
+    CHECK_EQ(*x.at(offset + 1), static_cast<Byte>('b'));
+}
+
+TEST_CASE("ChunkPool") {
+    using detail::ChunkPool;
+
+    SUBCASE("capacity") {
+        CHECK_EQ(ChunkPool::capacity(1), ChunkPool::MinBlockSize);
+        CHECK_EQ(ChunkPool::capacity(ChunkPool::MinBlockSize), ChunkPool::MinBlockSize);
+        CHECK_EQ(ChunkPool::capacity(ChunkPool::MinBlockSize + 1), 2 * ChunkPool::MinBlockSize);
+        CHECK_EQ(ChunkPool::capacity(4000), 4096U);
+        CHECK_EQ(ChunkPool::capacity(ChunkPool::MaxBlockSize), ChunkPool::MaxBlockSize);
+        CHECK_EQ(ChunkPool::capacity(ChunkPool::MaxBlockSize + 1), ChunkPool::MaxBlockSize + 1);
+    }
+
+    SUBCASE("reuse") {
+        ChunkPool pool;
+
+        auto* p1 = pool.allocate(100);
+        CHECK_EQ(pool.statistics().allocated, 1U);
+        CHECK_EQ(pool.statistics().reused, 0U);
+
+        pool.deallocate(p1, ChunkPool::capacity(100));
+        CHECK_EQ(pool.statistics().cached_bytes, 128U);
+
+        // Same size class, so we get the block back.
+        auto* p2 = pool.allocate(120);
+        CHECK_EQ(p2, p1);
+        CHECK_EQ(pool.statistics().reused, 1U);
+        CHECK_EQ(pool.statistics().cached_bytes, 0U);
+
+        // Different size class.
+        pool.deallocate(p2, ChunkPool::capacity(120));
+        auto* p3 = pool.allocate(1000);
+        CHECK_EQ(pool.statistics().allocated, 2U);
+        CHECK_EQ(pool.statistics().cached_bytes, 128U);
+
+        pool.deallocate(p3, ChunkPool::capacity(1000));
+        pool.clear();
+        CHECK_EQ(pool.statistics().cached_bytes, 0U);
+    }
+
+    SUBCASE("oversized") {
+        ChunkPool pool;
+
+        auto size = ChunkPool::MaxBlockSize + 1;
+        auto* p = pool.allocate(size);
+        pool.deallocate(p, ChunkPool::capacity(size));
+        CHECK_EQ(pool.statistics().cached_bytes, 0U);
+    }
+
+    SUBCASE("limit") {
+        ChunkPool pool;
+
+        std::vector<void*> blocks;
+        auto n = ChunkPool::MaxCachedBytesPerClass / ChunkPool::MaxBlockSize + 1;
+        for ( size_t i = 0; i < n; i++ )
+            blocks.push_back(pool.allocate(ChunkPool::MaxBlockSize));
+
+        for ( auto* p : blocks )
+            pool.deallocate(p, ChunkPool::MaxBlockSize);
+
+        CHECK_EQ(pool.statistics().cached_bytes, ChunkPool::MaxCachedBytesPerClass);
+    }
+
+    SUBCASE("chunk payload") {
+        auto data = std::string(1000, 'x');
+        auto c = detail::Chunk(0, data);
+
+        // The chunk's payload is allocated with its size class' capacity.
+        CHECK_EQ(c.size(), data.size());
+        CHECK_EQ(c.allocated(), ChunkPool::capacity(data.size()));
+    }
+}
+
+TEST_CASE("Shared data") {
+    auto shared = make_intrusive<SharedData>(std::string("0123456789"));
+    const auto* payload = shared->data();
+
+    Stream x("abc"_b);
+    Stream y;
+    x.append(shared);
+    y.append(shared);
+    y.append("xyz"_b);
+
+    CHECK_EQ(x, Stream("abc0123456789"_b));
+    CHECK_EQ(y, Stream("0123456789xyz"_b));
+
+    // Both streams reference the same payload instead of copies of it.
+    CHECK_EQ(x.at(3).chunk()->data(), payload);
+    CHECK_EQ(y.at(0).chunk()->data(), payload);
+    CHECK(y.at(0).chunk()->isShared());
+    CHECK(y.at(0).chunk()->isOwning());
+
+    // The payload stays around as long as any stream needs it.
+    shared = nullptr;
+    x = Stream();
+    CHECK_EQ(*y.at(5), static_cast<Byte>('5'));
+
+    // Copies of a stream keep referencing the payload as well.
+    auto z = y;
+    y.trim(y.at(10));
+    CHECK_EQ(z.at(0).chunk()->data(), payload);
+    CHECK_EQ(z, Stream("0123456789xyz"_b));
+
+    // Empty payloads are ignored.
+    Stream e;
+    e.append(make_intrusive<SharedData>(std::string()));
+    CHECK_EQ(e.numberOfChunks(), 0);
+}
+
 TEST_CASE("Block iteration") {
     auto content = [](auto b, auto s) -> bool { return memcmp(b->start, s, strlen(s)) == 0; };
 
@@ -1395,6 +1538,65 @@ TEST_CASE("View") {
         }
     }
 
+    SUBCASE("find - across chunks") {
+        auto s = make_stream({"0123"_b, "45"_b, "6"_b, "789AB"_b, "CDEF0123456789ABCDEF"_b});
+        auto v = s.view();
+
+        CHECK_EQ(v.find(Byte('5')), s.at(5));
+        CHECK_EQ(v.find(Byte('9'), s.at(10)), s.at(25));
+        CHECK_EQ(v.find(Byte('X')), v.end());
+
+        auto x = v.find("3456789"_b); // spans four chunks
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(3));
+
+        x = v.find("BCDEF012"_b); // straddles chunk boundary
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(11));
+
+        x = v.find("0123456789ABCDEF"_b); // fully inside last chunk
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(16));
+
+        x = v.find("DEFX"_b); // partial match at end
+        CHECK_EQ(tuple::get<0>(x), false);
+        CHECK_EQ(tuple::get<1>(x), s.at(29));
+
+        x = v.find(s.view().sub(s.at(4), s.at(8))); // needle spanning chunks itself
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(4));
+
+        s.append(nullptr, 3); // Gap.
+        CHECK_THROWS_WITH_AS(v.find(Byte('X')), "data is missing", const MissingData&);
+    }
+
+    SUBCASE("find - Searcher") {
+        auto s = make_stream({"GET /index.html HTTP/1.1\r"_b, "\nHost: "_b, "example.com\r\n\r"_b});
+        auto v = s.view();
+
+        const auto searcher = Searcher("\r\n\r\n"_b);
+        CHECK_EQ(searcher.size(), 4U);
+        CHECK_EQ(searcher.needle(), "\r\n\r\n"_b);
+
+        // Partial match at the end, search can resume from there.
+        auto x = v.find(searcher);
+        CHECK_EQ(tuple::get<0>(x), false);
+        CHECK_EQ(tuple::get<1>(x), s.at(43));
+
+        s.append("\n"_b);
+        x = v.find(searcher, tuple::get<1>(x));
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(43));
+
+        x = v.find(Searcher("HTTP/1.1\r\nHost"_b)); // straddles chunk boundary
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(16));
+
+        x = v.find(Searcher(""_b), s.at(5));
+        CHECK_EQ(tuple::get<0>(x), true);
+        CHECK_EQ(tuple::get<1>(x), s.at(5));
+    }
+
     SUBCASE("find - backwards") {
         SUBCASE("bytes - static view") {
             // This test is value-parameterized over `s`.
@@ -144,6 +144,71 @@ TEST_CASE("atoi_n") {
     }
 }
 
+TEST_CASE("control") {
+    using Block = control::Block<int, InvalidIterator>;
+
+    int x = 42;
+
+    SUBCASE("reference") {
+        Block b(&x);
+        Block::Ref r1 = b;
+        Block::Ref r2 = r1;
+
+        CHECK(r1.isValid());
+        CHECK_EQ(r1.get(), 42);
+        CHECK_EQ(r1, r2);
+        CHECK_EQ(Block::Ref(b), r1);
+        CHECK_NE(Block::Ref(), r1);
+    }
+
+    SUBCASE("reset") {
+        Block b(&x);
+        Block::Ref r = b;
+        b.Reset();
+
+        CHECK_FALSE(r.isValid());
+        CHECK_THROWS_WITH_AS(r.get(), "underlying object has expired", const InvalidIterator&);
+
+        // New references track the block again.
+        Block::Ref r2 = b;
+        CHECK(r2.isValid());
+        CHECK_NE(r, r2);
+    }
+
+    SUBCASE("destruction") {
+        Block::Ref r;
+
+        {
+            Block b(&x);
+            r = b;
+            CHECK(r.isValid());
+        }
+
+        CHECK_FALSE(r.isValid());
+    }
+
+    SUBCASE("assignment") {
+        Block b1(&x);
+        Block::Ref r1 = b1;
+
+        Block b2(&x);
+        b1 = b2;
+        CHECK_FALSE(r1.isValid());
+
+        Block b3(&x);
+        Block::Ref r3 = b3;
+        b1 = std::move(b3);
+        CHECK(r3.isValid());
+        CHECK_EQ(Block::Ref(b1), r3);
+    }
+
+    SUBCASE("invalid") {
+        Block::Ref r;
+        CHECK_FALSE(r.isValid());
+        CHECK_THROWS_WITH_AS(r.get(), "underlying object is invalid", const InvalidIterator&);
+    }
+}
+
 TEST_CASE("createTemporaryFile") {
     SUBCASE("success") {
         // This test is value-parameterized over `tmp`.
@@ -3,11 +3,18 @@
 // Note: We don't run clang-tidy on this file. The use of the JRX's C
 // interface triggers all kinds of warnings.
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
 #include <ranges>
 #include <utility>
 
+#include <hilti/rt/configuration.h>
+#include <hilti/rt/context.h>
 #include <hilti/rt/exception.h>
 #include <hilti/rt/global-state.h>
+#include <hilti/rt/profiler.h>
 #include <hilti/rt/types/regexp.h>
 #include <hilti/rt/util.h>
 
@@ -33,7 +40,7 @@ Result<uint64_t> regexp::Pattern::_tryCompile() const {
         return nsub;
     }
     else {
-        static char err[256];
+        char err[256];
         jrx_regerror(rc, &preg, err, sizeof(err));
         return result::Error(fmt("error compiling pattern '%s': %s", _value, err));
     }
@@ -49,11 +56,11 @@ Result<Nothing> regexp::Pattern::validate() const {
 Result<uint64_t> regexp::Pattern::numberOfCaptures() const { return _tryCompile(); }
 
 // Determines which matcher (std vs. min) to use.
-static bool _use_std_matcher(jrx_regex_t* jrx, jrx_match_state* ms) {
+static bool _use_std_matcher(const regexp::detail::CompiledRegExp& re, jrx_match_state* ms) {
     // Order of the checks is important.
     bool std = true;
 
-    if ( jrx_num_groups(jrx) == 1 )
+    if ( re.numGroups() == 1 )
         // No captures groups used, so don't need the standard matcher.
         std = false;
 
@@ -75,11 +82,11 @@ public:
     bool _done = false;
 
     jrx_match_state _ms{};
-    std::shared_ptr<regexp::detail::CompiledRegExp> _re;
+    std::shared_ptr<const regexp::detail::CompiledRegExp> _re;
 
     ~Pimpl() { jrx_match_state_done(&_ms); }
 
-    Pimpl(std::shared_ptr<regexp::detail::CompiledRegExp> re) : _re(std::move(re)) {
+    Pimpl(std::shared_ptr<const regexp::detail::CompiledRegExp> re) : _re(std::move(re)) {
         jrx_match_state_init(_re->jrx(), 0, &_ms);
     }
 
@@ -99,7 +106,7 @@ regexp::MatchState::MatchState(const MatchState& other) {
     if ( this == &other )
         return;
 
-    if ( other._pimpl->_re->jrx()->cflags & REG_STD_MATCHER )
+    if ( other._pimpl->_re->cflags() & REG_STD_MATCHER )
         throw InvalidArgument("cannot copy match state of regexp with sub-expressions support");
 
     _pimpl = std::make_unique<Pimpl>(*other._pimpl);
@@ -109,7 +116,7 @@ regexp::MatchState& regexp::MatchState::operator=(const MatchState& other) {
     if ( this == &other )
         return *this;
 
-    if ( other._pimpl->_re->jrx()->cflags & REG_STD_MATCHER )
+    if ( other._pimpl->_re->cflags() & REG_STD_MATCHER )
         throw InvalidArgument("cannot copy match state of regexp with sub-expressions support");
 
     _pimpl = std::make_unique<Pimpl>(*other._pimpl);
@@ -180,7 +187,8 @@ std::pair<int32_t, int64_t> regexp::MatchState::_advance(const stream::View& dat
     }
 
     jrx_accept_id rc = 0;
-    auto use_std_matcher = _use_std_matcher(_pimpl->_re->jrx(), &_pimpl->_ms);
+    auto* jrx = _pimpl->_re->jrx();
+    auto use_std_matcher = _use_std_matcher(*_pimpl->_re, &_pimpl->_ms);
     auto start_ms_offset = _pimpl->_ms.offset;
 
     for ( auto block = data.firstBlock(); block; block = data.nextBlock(block) ) {
@@ -196,7 +204,7 @@ std::pair<int32_t, int64_t> regexp::MatchState::_advance(const stream::View& dat
 #endif
 
         if ( use_std_matcher )
-            rc = static_cast<jrx_accept_id>(jrx_regexec_partial_std(_pimpl->_re->jrx(),
+            rc = static_cast<jrx_accept_id>(jrx_regexec_partial_std(jrx,
                                                                     reinterpret_cast<const char*>(block->start),
                                                                     block->size,
                                                                     first,
@@ -204,7 +212,7 @@ std::pair<int32_t, int64_t> regexp::MatchState::_advance(const stream::View& dat
                                                                     &_pimpl->_ms,
                                                                     final_block));
         else
-            rc = static_cast<jrx_accept_id>(jrx_regexec_partial_min(_pimpl->_re->jrx(),
+            rc = static_cast<jrx_accept_id>(jrx_regexec_partial_min(jrx,
                                                                     reinterpret_cast<const char*>(block->start),
                                                                     block->size,
                                                                     first,
@@ -244,7 +252,7 @@ regexp::Captures regexp::MatchState::captures(const stream::View& data) const {
 
     Captures captures = {};
 
-    auto num_groups = jrx_num_groups(_pimpl->_re->jrx());
+    auto num_groups = _pimpl->_re->numGroups();
     std::vector<jrx_regmatch_t> groups(num_groups);
     if ( jrx_reggroups(_pimpl->_re->jrx(), &_pimpl->_ms, num_groups, groups.data()) == REG_OK ) {
         for ( auto i = 0; i < num_groups; i++ ) {
@@ -266,58 +274,204 @@ void regexp::detail::CompiledRegExp::RegFree::operator()(jrx_regex_t* j) {
 
 regexp::detail::CompiledRegExp::CompiledRegExp(const regexp::Patterns& patterns, regexp::Flags flags)
     : _flags(flags), _patterns(patterns) {
-    _newJrx();
-
-    if ( patterns.empty() )
-        return;
-
-    for ( const auto& p : patterns )
-        _compileOne(p);
-
-    jrx_regset_finalize(jrx());
+    _compile();
+    _num_groups = jrx_num_groups(_jrx.get());
+    _cflags = _jrx->cflags;
 }
 
-void regexp::detail::CompiledRegExp::_newJrx() {
-    assert(! _jrx && "regexp already compiled");
-
-    int cflags = (REG_EXTENDED | REG_ANCHOR | REG_LAZY); // | REG_DEBUG;
+void regexp::detail::CompiledRegExp::_compile() {
+    // We build the DFA completely upfront (i.e., no `REG_LAZY`) so that
+    // matching never needs to extend it, which makes it safe to use the
+    // automaton from multiple threads concurrently.
+    int cflags = (REG_EXTENDED | REG_ANCHOR); // | REG_DEBUG;
 
     if ( _flags.no_sub )
         cflags |= REG_NOSUB;
     else if ( _flags.use_std )
         cflags |= REG_STD_MATCHER;
 
-    _patterns.clear();
-    _jrx = std::unique_ptr<jrx_regex_t, RegFree>(new jrx_regex_t);
-    jrx_regset_init(_jrx.get(), -1, cflags);
+    auto jrx = std::unique_ptr<jrx_regex_t, RegFree>(new jrx_regex_t);
+    jrx_regset_init(jrx.get(), -1, cflags);
+
+    for ( const auto& pattern : _patterns ) {
+        const auto& regexp = pattern.value();
+
+        int pflags = (pattern.isCaseInsensitive() ? REG_ICASE : 0);
+        auto id = static_cast<jrx_accept_id>(pattern.matchID());
+
+        if ( auto rc = jrx_regset_add2(jrx.get(), regexp.c_str(), regexp.size(), pflags, id); rc != REG_OK ) {
+            char err[256];
+            jrx_regerror(rc, jrx.get(), err, sizeof(err));
+            throw PatternError(fmt("error compiling pattern '%s': %s", pattern, err));
+        }
+    }
+
+    if ( ! _patterns.empty() )
+        jrx_regset_finalize(jrx.get());
+
+    _jrx = std::move(jrx);
+}
+
+jrx_accept_id regexp::detail::CompiledRegExp::_probe(std::string_view data) const {
+    auto* jrx = this->jrx();
+
+    jrx_match_state ms;
+    jrx_match_state_init(jrx, 0, &ms);
+
+    jrx_assertion first = JRX_ASSERTION_BOL | JRX_ASSERTION_BOD;
+    auto rc = jrx_regexec_partial_min(jrx, data.data(), data.size(), first, 0, &ms, false);
+
+    jrx_match_state_done(&ms);
+    return static_cast<jrx_accept_id>(rc);
+}
+
+void regexp::detail::CompiledRegExp::_computePrefilter() const {
+    // We probe the automaton byte by byte: a byte cannot begin a match if
+    // feeding it rules out all patterns. As long as there's exactly one byte
+    // that may come next, we extend the probing to collect a literal prefix
+    // that any match must begin with. We stop once that prefix could already
+    // be a match of its own.
+    constexpr size_t max_prefix = 16;
+
+    if ( _patterns.empty() )
+        return;
+
+    Prefilter prefilter;
+    std::string data;
+
+    while ( data.size() < max_prefix ) {
+        int next = -1;
+        int candidates = 0;
+        data.push_back('\0');
+
+        for ( int c = 0; c < 256; c++ ) {
+            data.back() = static_cast<char>(c);
+            if ( _probe(data) == 0 )
+                continue;
+
+            if ( data.size() == 1 )
+                prefilter.first_bytes[c] = true;
+
+            next = c;
+            ++candidates;
+        }
+
+        if ( candidates != 1 )
+            break;
+
+        data.back() = static_cast<char>(next);
+        prefilter.prefix = data;
+
+        if ( _probe(data) > 0 )
+            break;
+    }
+
+    prefilter.enabled = std::ranges::any_of(prefilter.first_bytes, [](auto b) { return ! b; });
+    _prefilter = std::move(prefilter);
 }
 
-void regexp::detail::CompiledRegExp::_compileOne(regexp::Pattern pattern) {
-    const auto& regexp = pattern.value();
+size_t regexp::detail::CompiledRegExp::findCandidate(const char* data, size_t len) const {
+    std::call_once(_prefilter_once, [this]() { _computePrefilter(); });
+
+    if ( ! _prefilter.enabled )
+        return 0;
+
+    const auto* const end = data + len;
+
+    if ( const auto& prefix = _prefilter.prefix; ! prefix.empty() ) {
+        // Jump from one occurrence of the prefix' first byte to the next.
+        // Near the end, a partial prefix counts as a candidate as more data
+        // may complete it.
+        for ( const auto* cur = data; cur < end; ++cur ) {
+            cur = static_cast<const char*>(memchr(cur, prefix[0], end - cur));
+            if ( ! cur )
+                break;
+
+            auto n = std::min(prefix.size(), static_cast<size_t>(end - cur));
+            if ( memcmp(cur, prefix.data(), n) == 0 )
+                return cur - data;
+        }
+
+        return len;
+    }
+
+    for ( const auto* cur = data; cur < end; ++cur ) {
+        if ( _prefilter.first_bytes[static_cast<unsigned char>(*cur)] )
+            return cur - data;
+    }
+
+    return len;
+}
 
-    int cflags = (pattern.isCaseInsensitive() ? REG_ICASE : 0);
-    auto id = static_cast<jrx_accept_id>(pattern.matchID());
+// Evicts the least recently used entry from the cache of compiled regular
+// expressions that's not currently in use by any other instance. Entries
+// still in use are moved to the front on the way as they are evidently
+// active. Returns false if all entries are in use. Caller must hold the
+// cache's lock.
+// Must be called with the cache's lock held exclusively.
+static bool _evictCompiledRegExp(detail::GlobalState::CompiledRegExpCache* cache) {
+    // Each entry may get passed over once for having been referenced, so two
+    // rounds are enough to find a victim if there's any.
+    for ( auto n = 2 * cache->lru.size(); n > 0; --n ) {
+        auto victim = std::prev(cache->lru.end());
+
+        // With the lock held, nobody can obtain a new reference to an entry
+        // that's only referenced by the cache itself.
+        if ( ! victim->referenced.exchange(false, std::memory_order_relaxed) && victim->regexp.use_count() == 1 ) {
+            cache->entries.erase(victim->key);
+            cache->lru.erase(victim);
+            profiler::count("hilti/regexp/compiled-cache-evictions");
+            return true;
+        }
 
-    if ( auto rc = jrx_regset_add2(_jrx.get(), regexp.c_str(), regexp.size(), cflags, id); rc != REG_OK ) {
-        static char err[256];
-        jrx_regerror(rc, _jrx.get(), err, sizeof(err));
-        throw PatternError(fmt("error compiling pattern '%s': %s", pattern, err));
+        cache->lru.splice(cache->lru.begin(), cache->lru, victim);
     }
 
-    _patterns.push_back(std::move(pattern));
+    return false;
 }
 
 RegExp::RegExp(const regexp::Patterns& patterns, regexp::Flags flags) {
-    const auto& key =
-        (patterns.empty() ? std::string() :
-                            join(patterns | std::views::transform([](const auto& p) { return to_string(p); }), "|") +
-                                "|" + flags.cacheKey());
-    auto& ptr = detail::globalState()->regexp_cache[key];
+    auto key = (patterns.empty() ? std::string() :
+                                   join(patterns | std::views::transform([](const auto& p) { return to_string(p); }),
+                                        "|") + "|" + flags.cacheKey());
 
-    if ( ! ptr )
-        ptr = std::make_shared<regexp::detail::CompiledRegExp>(patterns, flags);
+    auto* cache = &detail::globalState()->compiled_regexp_cache;
 
-    _re = ptr;
+    {
+        std::shared_lock lock(cache->mutex);
+
+        if ( auto i = cache->entries.find(key); i != cache->entries.end() ) {
+            profiler::count("hilti/regexp/compiled-cache-hits");
+            i->second->referenced.store(true, std::memory_order_relaxed);
+            _re = i->second->regexp;
+            return;
+        }
+    }
+
+    // Compile without holding the lock so that other threads can proceed.
+    profiler::count("hilti/regexp/compiled-cache-misses");
+    auto p = profiler::start("hilti/regexp/compile");
+    auto re = std::make_shared<const regexp::detail::CompiledRegExp>(patterns, flags);
+    profiler::stop(p);
+
+    std::unique_lock lock(cache->mutex);
+
+    if ( auto i = cache->entries.find(key); i != cache->entries.end() ) {
+        // Another thread compiled the same patterns in the meantime, share its instance.
+        i->second->referenced.store(true, std::memory_order_relaxed);
+        _re = i->second->regexp;
+        return;
+    }
+
+    if ( cache->entries.size() < configuration::get().compiled_regexp_cache_size || _evictCompiledRegExp(cache) ) {
+        cache->lru.emplace_front(key, re);
+        cache->entries.emplace(std::move(key), cache->lru.begin());
+    }
+    else
+        // All cached entries are in use, keep this one private.
+        profiler::count("hilti/regexp/compiled-cache-bypasses");
+
+    _re = std::move(re);
 }
 
 RegExp::RegExp(regexp::Pattern pattern, regexp::Flags flags) : RegExp(regexp::Patterns{{std::move(pattern)}}, flags) {}
@@ -326,7 +480,7 @@ RegExp::RegExp() : RegExp(regexp::Patterns{}, regexp::Flags{}) {}
 
 int32_t RegExp::match(const Bytes& data) const {
     jrx_match_state ms;
-    jrx_accept_id acc = _search_pattern(&ms, data.data(), data.size(), nullptr, nullptr);
+    jrx_accept_id acc = _search_pattern(jrx(), &ms, data.data(), data.size(), nullptr, nullptr);
     jrx_match_state_done(&ms);
     return acc;
 }
@@ -339,27 +493,26 @@ static Bytes _subslice(const Bytes& data, jrx_offset so, jrx_offset eo) {
 }
 
 Vector<Bytes> RegExp::matchGroups(const Bytes& data) const {
-    assert(jrx() && "regexp not compiled");
-
     if ( _re->_patterns.size() > 1 )
         throw NotSupported("cannot capture groups during set matching");
 
     if ( _re->_flags.no_sub )
         throw NotSupported("cannot capture groups when compiled with &nosub");
 
+    auto* jrx = this->jrx();
     jrx_offset so = -1;
     jrx_offset eo = -1;
     jrx_match_state ms;
-    auto rc = _search_pattern(&ms, data.data(), data.size(), &so, &eo);
+    auto rc = _search_pattern(jrx, &ms, data.data(), data.size(), &so, &eo);
 
     Vector<Bytes> groups;
 
     if ( rc > 0 ) {
         groups.emplace_back(_subslice(data, so, eo));
 
-        if ( auto num_groups = jrx_num_groups(jrx()); num_groups > 1 ) {
+        if ( auto num_groups = _re->numGroups(); num_groups > 1 ) {
             std::vector<jrx_regmatch_t> pmatch(num_groups);
-            jrx_reggroups(jrx(), &ms, num_groups, pmatch.data());
+            jrx_reggroups(jrx, &ms, num_groups, pmatch.data());
 
             for ( int i = 1; i < num_groups; i++ ) {
                 if ( pmatch[i].rm_so >= 0 )
@@ -380,11 +533,18 @@ Tuple<int32_t, Bytes> RegExp::find(const Bytes& data) const {
     jrx_offset cur_so = -1;
     jrx_offset cur_eo = -1;
 
+    auto* jrx = this->jrx();
+
     for ( const auto* cur = startp; cur < endp; cur++ ) {
+        // Skip over positions where no match can start.
+        cur += _re->findCandidate(cur, endp - cur);
+        if ( cur == endp )
+            break;
+
         jrx_offset so = -1; // just initialize with something, will be set by search_pattern to >=0 on match
         jrx_offset eo = -1; // likewise
         jrx_match_state ms;
-        auto rc = _search_pattern(&ms, cur, endp - cur, &so, &eo);
+        auto rc = _search_pattern(jrx, &ms, cur, endp - cur, &so, &eo);
 
         if ( rc > 0 ) {
             assert(so >= 0 && eo >= 0);
@@ -419,24 +579,25 @@ Tuple<int32_t, Bytes> RegExp::find(const Bytes& data) const {
 
 regexp::MatchState RegExp::tokenMatcher() const { return regexp::MatchState(*this); }
 
-jrx_accept_id RegExp::_search_pattern(jrx_match_state* ms,
+jrx_accept_id RegExp::_search_pattern(jrx_regex_t* jrx,
+                                      jrx_match_state* ms,
                                       const char* data,
                                       size_t len,
                                       jrx_offset* so,
                                       jrx_offset* eo) const {
     if ( len == 0 ) {
         // Nothing to do, but still need to init the match state.
-        jrx_match_state_init(jrx(), 0, ms);
+        jrx_match_state_init(jrx, 0, ms);
         return -1;
     }
 
     const jrx_assertion last = JRX_ASSERTION_EOL | JRX_ASSERTION_EOD;
     jrx_assertion first = JRX_ASSERTION_BOL | JRX_ASSERTION_BOD;
 
-    jrx_match_state_init(jrx(), 0, ms);
+    jrx_match_state_init(jrx, 0, ms);
     jrx_accept_id rc = 0;
 
-    auto use_std_matcher = _use_std_matcher(jrx(), ms);
+    auto use_std_matcher = _use_std_matcher(*_re, ms);
 
 #ifdef _DEBUG_MATCHING
     std::cerr << fmt("feeding |%s| use_std_matcher=%u first=%u last=%u\n",
@@ -447,9 +608,9 @@ jrx_accept_id RegExp::_search_pattern(jrx_match_state* ms,
 #endif
 
     if ( use_std_matcher )
-        rc = static_cast<jrx_accept_id>(jrx_regexec_partial_std(jrx(), data, len, first, last, ms, true));
+        rc = static_cast<jrx_accept_id>(jrx_regexec_partial_std(jrx, data, len, first, last, ms, true));
     else
-        rc = static_cast<jrx_accept_id>(jrx_regexec_partial_min(jrx(), data, len, first, last, ms, true));
+        rc = static_cast<jrx_accept_id>(jrx_regexec_partial_min(jrx, data, len, first, last, ms, true));
 
 #ifdef _DEBUG_MATCHING
     std::cerr << fmt("-> rc=%d ms->offset=%d\n", rc, ms->offset);
@@ -458,7 +619,7 @@ jrx_accept_id RegExp::_search_pattern(jrx_match_state* ms,
     if ( rc > 0 ) {
         if ( use_std_matcher ) {
             jrx_regmatch_t pmatch;
-            jrx_reggroups(jrx(), ms, 1, &pmatch);
+            jrx_reggroups(jrx, ms, 1, &pmatch);
 
             if ( so )
                 *so = pmatch.rm_so; // 0-based
@@ -0,0 +1,77 @@
+// Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
+
+#include <bit>
+#include <cassert>
+#include <new>
+
+#include <hilti/rt/context.h>
+#include <hilti/rt/types/stream-pool.h>
+
+using namespace hilti::rt;
+using namespace hilti::rt::stream::detail;
+
+size_t ChunkPool::_sizeClass(size_t capacity) {
+    assert(capacity >= MinBlockSize && capacity <= MaxBlockSize && std::has_single_bit(capacity));
+    return static_cast<size_t>(std::countr_zero(capacity) - std::countr_zero(MinBlockSize));
+}
+
+void* ChunkPool::allocate(size_t size) {
+    auto c = capacity(size);
+
+    if ( c <= MaxBlockSize ) {
+        auto& free = _free[_sizeClass(c)];
+        if ( ! free.empty() ) {
+            auto* p = free.back();
+            free.pop_back();
+            _statistics.cached_bytes -= c;
+            ++_statistics.reused;
+            return p;
+        }
+    }
+
+    ++_statistics.allocated;
+    return ::operator new(c);
+}
+
+void ChunkPool::deallocate(void* p, size_t capacity) {
+    if ( ! p )
+        return;
+
+    if ( capacity <= MaxBlockSize ) {
+        auto& free = _free[_sizeClass(capacity)];
+        if ( (free.size() + 1) * capacity <= MaxCachedBytesPerClass ) {
+            free.push_back(p);
+            _statistics.cached_bytes += capacity;
+            return;
+        }
+    }
+
+    ::operator delete(p);
+}
+
+void ChunkPool::clear() {
+    for ( auto& free : _free ) {
+        for ( auto* p : free )
+            ::operator delete(p);
+
+        free.clear();
+    }
+
+    _statistics.cached_bytes = 0;
+}
+
+void* stream::detail::allocate(size_t size, size_t* capacity) {
+    *capacity = ChunkPool::capacity(size);
+
+    if ( auto* context = context::detail::get(true) )
+        return context->stream_pool.allocate(size);
+
+    return ::operator new(*capacity);
+}
+
+void stream::detail::deallocate(void* p, size_t capacity) {
+    if ( auto* context = context::detail::get(true) )
+        context->stream_pool.deallocate(p, capacity);
+    else
+        ::operator delete(p);
+}
@@ -18,7 +18,7 @@ const Byte* EmptyData = reinterpret_cast<const Byte*>("<empty>");
 
 void Chunk::destroy() {
     if ( _allocated > 0 )
-        delete[] _data;
+        detail::deallocate(const_cast<Byte*>(_data), _allocated); // cast is safe because it's allocated
 
     // The default dtr would turn deletion the list behind `_next` into a
     // recursive list traversal. For very long lists this could lead to stack
@@ -30,37 +30,37 @@ void Chunk::destroy() {
     _next = nullptr;
 }
 
-Chunk::Chunk(const Offset& offset, const View& d) : _offset(offset), _size(d.size()), _allocated(_size) {
+Chunk::Chunk(const Offset& offset, const View& d) : _offset(offset), _size(d.size()) {
     if ( _size == 0 ) {
         _data = EmptyData;
         return;
     }
 
-    auto data = std::make_unique<Byte[]>(_size);
-    d.copyRaw(data.get());
-    _data = data.release();
+    auto* data = static_cast<Byte*>(detail::allocate(_size, &_allocated));
+    d.copyRaw(data);
+    _data = data;
 }
 
-Chunk::Chunk(const Offset& offset, std::string_view s) : _offset(offset), _size(s.size()), _allocated(_size) {
+Chunk::Chunk(const Offset& offset, std::string_view s) : _offset(offset), _size(s.size()) {
     if ( _size == 0 ) {
         _data = EmptyData;
         return;
     }
 
-    auto data = std::make_unique<Byte[]>(_size);
-    memcpy(data.get(), s.data(), _size);
-    _data = data.release();
+    auto* data = static_cast<Byte*>(detail::allocate(_size, &_allocated));
+    memcpy(data, s.data(), _size);
+    _data = data;
 }
 
-Chunk::Chunk(const Offset& offset, const Byte* b, size_t size) : _offset(offset), _size(size), _allocated(_size) {
+Chunk::Chunk(const Offset& offset, const Byte* b, size_t size) : _offset(offset), _size(size) {
     if ( _size == 0 ) {
         _data = EmptyData;
         return;
     }
 
-    auto data = std::make_unique<Byte[]>(_size);
-    memcpy(data.get(), b, _size);
-    _data = data.release();
+    auto* data = static_cast<Byte*>(detail::allocate(_size, &_allocated));
+    memcpy(data, b, _size);
+    _data = data;
 }
 
 void Chain::append(const Byte* data, size_t size) {
@@ -105,6 +105,13 @@ void Chain::append(Bytes&& data) {
         append(std::make_unique<Chunk>(0, std::move(data).str()));
 }
 
+void Chain::append(const SharedDataPtr& data) {
+    if ( data->size() == 0 )
+        return;
+
+    append(std::make_unique<Chunk>(0, data));
+}
+
 void Chain::append(std::unique_ptr<Chunk> chunk) {
     _ensureValid();
     _ensureMutable();
@@ -118,6 +125,8 @@ void Chain::append(std::unique_ptr<Chunk> chunk) {
         _statistics.num_data_chunks++;
     }
 
+    auto* c = chunk.get();
+
     if ( _tail ) {
         _tail->setNext(std::move(chunk));
         _tail = _tail->last();
@@ -129,6 +138,8 @@ void Chain::append(std::unique_ptr<Chunk> chunk) {
         _head = std::move(chunk);
         _tail = _head->last();
     }
+
+    _indexChunks(c);
 }
 
 void Chain::append(Chain&& other) {
@@ -141,8 +152,10 @@ void Chain::append(Chain&& other) {
 
     _statistics += other._statistics;
 
+    auto* c = other._head.get();
     _tail->setNext(std::move(other._head));
     _tail = other._tail;
+    _indexChunks(c);
     other.reset();
 }
 
@@ -171,16 +184,19 @@ void Chain::trim(const Offset& offset) {
 
             auto next = std::move(_head->_next);
 
-            if ( ! _head->isGap() &&
+            if ( ! _head->isGap() && ! _head->isShared() &&
                  (! _cached || (! _head->isOwning() || _head->allocated() > _cached->allocated())) ) {
                 // Cache chunk for later reuse. If we already have cached one,
                 // we prefer the one that's larger. Note that the chunk may be
                 // non-owning, we account for that when checking if we can
-                // reuse.
+                // reuse. We don't cache chunks referencing shared payloads as
+                // that would keep the payload alive without being able to
+                // reuse it.
                 _cached = std::move(_head);
                 _cached->detach();
             }
 
+            _unindexHead();
             _head = std::move(next); // deletes chunk if not cached
 
             if ( ! _head || _head->isLast() )
@@ -215,14 +231,6 @@ ChainPtr Chain::copy() const {
     return nchain;
 }
 
-int Chain::numberOfChunks() const {
-    int n = 0;
-    for ( auto* ch = _head.get(); ch; ch = ch->_next.get() )
-        ++n;
-
-    return n;
-}
-
 bool View::isComplete() const {
     _ensureValid();
 
@@ -286,76 +294,211 @@ UnsafeConstIterator View::find(Byte b, UnsafeConstIterator n) const {
     if ( ! n )
         n = unsafeBegin();
 
-    for ( auto i = n; i != unsafeEnd(); ++i ) {
-        if ( *i == b )
-            return i;
+    const auto* chain = _begin.chain();
+    if ( ! chain )
+        return unsafeEnd();
+
+    const auto end = unsafeEnd();
+    const auto end_offset = std::min(end.offset().Ref(), chain->endOffset().Ref());
+    auto offset = n.offset().Ref();
+
+    if ( offset >= end_offset )
+        return end;
+
+    const auto* c = n.chunk();
+    if ( ! (c && c->inRange(offset)) )
+        c = chain->findChunk(offset, c);
+
+    // Scan the chunks block-wise, letting `memchr` do the heavy lifting.
+    for ( ; c && offset < end_offset; c = c->next() ) {
+        if ( c->isGap() )
+            throw MissingData("data is missing");
+
+        const auto block_end = std::min(c->endOffset().Ref(), end_offset);
+        const auto* start = c->data(offset);
+
+        if ( const auto* p = static_cast<const Byte*>(::memchr(start, b, block_end - offset)) )
+            return UnsafeConstIterator(chain, offset + (p - start), c);
+
+        offset = block_end;
     }
 
-    return unsafeEnd();
+    return end;
 }
 
-Tuple<bool, UnsafeConstIterator> View::find(const View& v, UnsafeConstIterator n) const {
-    if ( ! n )
-        n = UnsafeConstIterator(_begin);
+namespace {
 
-    if ( v.isEmpty() )
-        return tuple::make(true, n);
+// Minimum needle length for which we use Horspool searching inside a block.
+// For shorter needles, a `memchr` scan for the first byte is faster.
+constexpr size_t HorspoolMinNeedleSize = 4;
 
-    auto first = *v.unsafeBegin();
+// Minimum block size for which we use Horspool searching. For smaller blocks,
+// setting up the skip table costs more than it saves.
+constexpr size_t HorspoolMinBlockSize = 256;
 
-    for ( auto i = n; true; ++i ) {
-        if ( i == unsafeEnd() )
-            return tuple::make(false, i);
+// Fills in the Boyer-Moore-Horspool shift table for a needle.
+void initSkipTable(SkipTable* skip, const Byte* needle, size_t needle_size) {
+    skip->fill(needle_size);
 
-        if ( *i != first )
-            continue;
+    for ( size_t i = 0; i + 1 < needle_size; ++i )
+        (*skip)[needle[i]] = needle_size - 1 - i;
+}
 
-        auto x = i;
-        auto y = v.unsafeBegin();
+// Searches a contiguous block of data for the first position where the
+// needle matches *completely* inside the block. Returns null if there's no
+// such position. If the caller has a precomputed Horspool table for the
+// needle, it can pass that in through *skip*.
+const Byte* findInBlock(const Byte* data, size_t size, const Byte* needle, size_t needle_size,
+                        const SkipTable* skip) {
+    assert(needle_size > 0);
 
-        for ( ;; ) {
-            if ( x == unsafeEnd() )
-                return tuple::make(false, i);
+    if ( size < needle_size )
+        return nullptr;
 
-            if ( *x++ != *y++ )
-                break;
+    if ( needle_size == 1 )
+        return static_cast<const Byte*>(::memchr(data, needle[0], size));
 
-            if ( y == v.unsafeEnd() )
-                return tuple::make(true, i);
+    const auto* last = data + (size - needle_size); // last position where needle can fit
+
+    if ( needle_size < HorspoolMinNeedleSize || (! skip && size < HorspoolMinBlockSize) ) {
+        for ( const auto* p = data; p <= last; ++p ) {
+            p = static_cast<const Byte*>(::memchr(p, needle[0], last - p + 1));
+            if ( ! p )
+                return nullptr;
+
+            if ( ::memcmp(p + 1, needle + 1, needle_size - 1) == 0 )
+                return p;
         }
+
+        return nullptr;
+    }
+
+    // Boyer-Moore-Horspool.
+    SkipTable local_skip;
+    if ( ! skip ) {
+        initSkipTable(&local_skip, needle, needle_size);
+        skip = &local_skip;
+    }
+
+    const auto needle_last = needle[needle_size - 1];
+
+    for ( size_t i = 0; i <= size - needle_size; i += (*skip)[data[i + needle_size - 1]] ) {
+        if ( data[i + needle_size - 1] == needle_last && ::memcmp(data + i, needle, needle_size - 1) == 0 )
+            return data + i;
     }
+
+    return nullptr;
 }
 
-Tuple<bool, UnsafeConstIterator> View::_findForward(const Bytes& v, UnsafeConstIterator n) const {
+// Result of matching a needle at a given stream position.
+enum class Match { Yes, No, Partial };
+
+// Compares the needle against the stream data starting at `offset`, which
+// must be inside chunk `c`, following the chain across chunk boundaries as
+// needed. Returns `Partial` if the data available up to `end_offset` matches
+// a prefix of the needle.
+Match matchAt(const Chunk* c, uint64_t offset, uint64_t end_offset, const Byte* needle, size_t needle_size) {
+    size_t i = 0;
+
+    while ( i < needle_size ) {
+        if ( offset >= end_offset )
+            return Match::Partial;
+
+        while ( c && ! c->inRange(offset) )
+            c = c->next();
+
+        if ( ! c )
+            return Match::Partial;
+
+        if ( c->isGap() )
+            throw MissingData("data is missing");
+
+        const auto n = std::min(std::min(c->endOffset().Ref(), end_offset) - offset, uint64_t(needle_size - i));
+
+        if ( ::memcmp(c->data(offset), needle + i, n) != 0 )
+            return Match::No;
+
+        i += n;
+        offset += n;
+    }
+
+    return Match::Yes;
+}
+
+} // namespace
+
+Searcher::Searcher(Bytes needle) : _needle(std::move(needle)) {
+    initSkipTable(&_skip, reinterpret_cast<const Byte*>(_needle.data()), _needle.size());
+}
+
+Tuple<bool, UnsafeConstIterator> View::_findForward(const Byte* needle, size_t needle_size, UnsafeConstIterator n,
+                                                    const SkipTable* skip) const {
     if ( ! n )
         n = UnsafeConstIterator(_begin);
 
-    if ( v.isEmpty() )
+    if ( needle_size == 0 )
         return tuple::make(true, n);
 
-    auto first = *v.unsafeBegin();
-
-    for ( auto i = n; true; ++i ) {
-        if ( i == unsafeEnd() )
-            return tuple::make(false, i);
+    const auto* chain = _begin.chain();
+    if ( ! chain )
+        return tuple::make(false, unsafeEnd());
 
-        if ( *i != first )
-            continue;
+    const auto end_offset = std::min(unsafeEnd().offset().Ref(), chain->endOffset().Ref());
+    auto offset = n.offset().Ref();
 
-        auto x = i;
-        auto y = v.unsafeBegin();
+    if ( offset >= end_offset )
+        return tuple::make(false, n);
 
-        for ( ;; ) {
-            if ( x == unsafeEnd() )
-                return tuple::make(false, i);
+    const auto* c = n.chunk();
+    if ( ! (c && c->inRange(offset)) )
+        c = chain->findChunk(offset, c);
 
-            if ( *x++ != *y++ )
+    for ( ; c && offset < end_offset; c = c->next() ) {
+        if ( c->isGap() )
+            throw MissingData("data is missing");
+
+        const auto block_end = std::min(c->endOffset().Ref(), end_offset);
+        const auto* start = c->data(offset);
+        const auto size = block_end - offset;
+
+        // First look for a match fully contained inside the current chunk.
+        if ( const auto* p = findInBlock(start, size, needle, needle_size, skip) )
+            return tuple::make(true, UnsafeConstIterator(chain, offset + (p - start), c));
+
+        // Then check the trailing positions where a match would straddle
+        // the chunk's end, stitching together data from subsequent chunks.
+        const auto tail = (size >= needle_size ? size - needle_size + 1 : 0);
+        for ( const auto* p = start + tail; p < start + size; ++p ) {
+            p = static_cast<const Byte*>(::memchr(p, needle[0], (start + size) - p));
+            if ( ! p )
                 break;
 
-            if ( y == v.unsafeEnd() )
-                return tuple::make(true, i);
+            const auto o = offset + (p - start);
+            switch ( matchAt(c, o, end_offset, needle, needle_size) ) {
+                case Match::Yes: return tuple::make(true, UnsafeConstIterator(chain, o, c));
+                case Match::Partial: return tuple::make(false, UnsafeConstIterator(chain, o, c));
+                case Match::No: break;
+            }
         }
+
+        offset = block_end;
     }
+
+    return tuple::make(false, n + (end_offset - n.offset().Ref()));
+}
+
+Tuple<bool, UnsafeConstIterator> View::find(const View& v, UnsafeConstIterator n) const {
+    // Search directly on the needle's data if it's contiguous, otherwise
+    // linearize it first.
+    if ( auto block = v.firstBlock(); block && block->is_last )
+        return _findForward(block->start, block->size, n);
+
+    const auto data = v.data();
+    return _findForward(reinterpret_cast<const Byte*>(data.data()), data.size(), n);
+}
+
+Tuple<bool, UnsafeConstIterator> View::_findForward(const Bytes& v, UnsafeConstIterator n) const {
+    return _findForward(reinterpret_cast<const Byte*>(v.data()), v.size(), n);
 }
 
 Tuple<bool, UnsafeConstIterator> View::_findBackward(const Bytes& needle, UnsafeConstIterator i) const {
@@ -501,6 +644,8 @@ void Stream::append(const Bytes& data) { _chain->append(reinterpret_cast<const B
 
 void Stream::append(Bytes&& data) { _chain->append(std::move(data)); }
 
+void Stream::append(const stream::SharedDataPtr& data) { _chain->append(data); }
+
 void Stream::append(const char* data, size_t len) {
     if ( data )
         _chain->append(reinterpret_cast<const Byte*>(data), len);
@@ -24,6 +24,7 @@
 #include <hilti/rt/autogen/config.h>
 #include <hilti/rt/autogen/version.h>
 #include <hilti/rt/backtrace.h>
+#include <hilti/rt/context.h>
 #include <hilti/rt/exception.h>
 #include <hilti/rt/fiber.h>
 #include <hilti/rt/fmt.h>
@@ -73,6 +74,18 @@ hilti::rt::ResourceUsage hilti::rt::resource_usage() {
     stats.max_fiber_stack_size = fibers.max_stack_size;
     stats.cached_fibers = fibers.cached;
 
+    if ( auto* context = context::detail::get(true) ) {
+        const auto& pool = context->stream_pool.statistics();
+        stats.stream_pool_cached = pool.cached_bytes;
+        stats.stream_pool_reused = pool.reused;
+        stats.stream_pool_allocated = pool.allocated;
+    }
+    else {
+        stats.stream_pool_cached = 0;
+        stats.stream_pool_reused = 0;
+        stats.stream_pool_allocated = 0;
+    }
+
     return stats;
 }
 
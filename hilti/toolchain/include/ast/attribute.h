@@ -91,6 +91,7 @@ const Kind HavePrototype("&have_prototype");
 const Kind Internal("&internal");
 const Kind NeededByFeature("&needed-by-feature");
 const Kind NoEmit("&no-emit");
+const Kind NoFiberIfFrozen("&no-fiber-if-frozen");
 const Kind Nosub("&nosub");
 const Kind OnHeap("&on-heap");
 const Kind Optional("&optional");
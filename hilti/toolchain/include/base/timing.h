@@ -122,6 +122,7 @@ private:
     Time _time_started;
     Duration _time_used = Duration(0);
     uint64_t _num_completed = 0;
+    uint64_t _num_items = 0;
     int64_t _level = 0;
     std::string _name;
 };
@@ -140,6 +141,13 @@ public:
 
     void finish() { _ledger->finish(); }
 
+    /**
+     * Records a number of work items processed inside the measured block.
+     * The summary reports the accumulated total alongside the ledger's
+     * execution count.
+     */
+    void addItems(uint64_t n) { _ledger->_num_items += n; }
+
     Collector() = delete;
     Collector(const Collector&) = delete;
     Collector(Collector&&) noexcept = delete;
@@ -116,12 +116,33 @@ public:
                            const std::vector<cxx::Expression>& args,
                            bool throw_on_error);
 
+    /**
+     * Compiles a tuple assignment of the form `(x, data) = *unpack<T>(data,
+     * ...)` into a fast path that unpacks the value directly into `x` and
+     * advances the view `data` in place, without going through the
+     * intermediary result tuple. This applies only to integer types unpacked
+     * from stream views.
+     *
+     * @param targets the LHS elements of the tuple assignment
+     * @param src the RHS of the assignment
+     * @returns the compiled assignment, or nothing if the assignment does not
+     * match the pattern
+     */
+    std::optional<cxx::Expression> unpackInPlace(const node::Range<Expression>& targets, Expression* src);
+
     cxx::Expression addTmp(const std::string& prefix, const cxx::Type& t);
     cxx::Expression addTmp(const std::string& prefix, const cxx::Expression& init);
 
     cxx::Expression startProfiler(const std::string& name, cxx::Block* block = nullptr, bool insert_at_front = false);
     void stopProfiler(const cxx::Expression& profiler, cxx::Block* block = nullptr);
 
+    /**
+     * Returns a global holding the runtime's profiler slot for a given name,
+     * adding it to the current unit on first use. The slot gets allocated
+     * when the unit is loaded.
+     */
+    cxx::Expression profilerSlot(const std::string& name);
+
     cxx::Expression unsignedIntegerToBitfield(QualifiedType* t,
                                               const cxx::Expression& value,
                                               const cxx::Expression& bitorder);
@@ -176,6 +197,7 @@ private:
     std::vector<detail::cxx::Block*> _cxx_blocks;
     std::vector<detail::cxx::declaration::Local> _tmps;
     std::map<std::string, int> _tmp_counters;
+    std::map<std::string, cxx::Expression> _profiler_slots;
     hilti::util::Cache<cxx::ID, codegen::CxxTypes> _cache_types_storage;
     hilti::util::Cache<cxx::ID, codegen::CxxTypeInfo> _cache_type_info;
     hilti::util::Cache<cxx::ID, cxx::declaration::Type> _cache_types_declarations;
@@ -122,6 +122,12 @@ using hilti::rt::Library;
  */
 class JIT {
 public:
+    /** Statistics about lookups in the cache of compiled object files. */
+    struct CacheStatistics {
+        uint64_t hits = 0;   /**< number of object files taken from the cache */
+        uint64_t misses = 0; /**< number of object files that had to be compiled */
+    };
+
     /**
      * @param context compiler context to use
      * @param dump_code if true, save all C++ code into files `dbg.*` for debugging
@@ -164,6 +170,12 @@ public:
      */
     Result<std::shared_ptr<const Library>> build();
 
+    /**
+     * Returns statistics about the object file cache so far. They remain
+     * zero if the cache isn't enabled through `HILTI_JIT_CACHE_DIR`.
+     */
+    const auto& cacheStatistics() const { return _cache_statistics; }
+
     /** Returns the compiler context in use. */
     auto context() const { return _context.lock(); }
 
@@ -219,6 +231,7 @@ private:
 
     JobRunner _runner;
     std::size_t _hash = 0;
+    CacheStatistics _cache_statistics;
 };
 
 } // namespace hilti
@@ -68,6 +68,25 @@ public:
      */
     Result<Nothing> codegen();
 
+    /**
+     * Performs the first part of `codegen()`: lowers the module's AST into
+     * C++ declarations, without yet rendering them into C++ source code.
+     * Must be followed by `finalizeCxx()`.
+     *
+     * @returns success if no error occurred, and an appropriate error otherwise
+     */
+    Result<Nothing> lowerToCxx();
+
+    /**
+     * Performs the second part of `codegen()`: renders the C++ declarations
+     * produced by `lowerToCxx()` into C++ source code. This no longer
+     * accesses the AST, and hence may execute concurrently for different
+     * units.
+     *
+     * @returns success if no error occurred, and an appropriate error otherwise
+     */
+    Result<Nothing> finalizeCxx();
+
     /**
      *
      * Prints out a HILTI module by recreating its code from the
@@ -340,9 +340,9 @@ declaration::Module* ASTContext::newModule(Builder* builder,
 void ASTContext::garbageCollect() {
     hilti::util::timing::Collector _("hilti/compiler/ast/garbage-collector");
 
-    // We're compacting the node array until all non-retained nodes are gone.
-
-    std::vector<std::unique_ptr<Node>> new_nodes;
+    // We're compacting the node array in place until all non-retained nodes
+    // are gone. Deleting a node may release its children, so we may need
+    // multiple passes.
 
     size_t collected = 0;
     size_t retained = 0;
@@ -352,15 +352,16 @@ void ASTContext::garbageCollect() {
     do {
         ++rounds;
         retained = 0;
-        new_nodes.reserve(_nodes.size()); // NOLINT -- This can trigger various use-after-move warnings
         changed = false;
 
         for ( auto& n : _nodes ) {
             assert(n.get());
 
             if ( n->isRetained() ) {
+                if ( &n != &_nodes[retained] )
+                    _nodes[retained] = std::move(n);
+
                 ++retained;
-                new_nodes.emplace_back(std::move(n));
             }
             else {
                 changed = true;
@@ -369,7 +370,7 @@ void ASTContext::garbageCollect() {
             }
         }
 
-        _nodes = std::move(new_nodes);
+        _nodes.resize(retained);
     } while ( changed );
 
     HILTI_DEBUG(logging::debug::AstStats,
@@ -802,8 +803,19 @@ Result<Nothing> ASTContext::_resolve(Builder* builder, const Plugin& plugin) {
         checkAST(false);
 #endif
 
-        clearErrors();
-        clearScopes();
+        util::timing::Collector round_timer(fmt("hilti/compiler/ast/resolver/round-%u", round));
+
+        // Reset per-node state, counting the nodes we'll be processing this
+        // round on the way. We do this in a single pass rather than through
+        // `clearErrors()` and `clearScopes()` to avoid walking the AST twice.
+        size_t num_nodes = 0;
+
+        for ( const auto& n : visitor::range(visitor::PreOrder(), root(), {}) ) {
+            n->clearErrors();
+            n->clearScope();
+            ++num_nodes;
+        }
+
         _buildScopes(builder, plugin);
         type_unifier::unify(builder, root());
         operator_::registry().initPending(builder);
@@ -812,6 +824,10 @@ Result<Nothing> ASTContext::_resolve(Builder* builder, const Plugin& plugin) {
         if ( auto rc = _resolveRoot(&modified, builder, plugin); ! rc )
             return rc;
 
+        round_timer.addItems(num_nodes);
+        HILTI_DEBUG(logging::debug::AstStats,
+                    fmt("[%s] round %u: processed %zu nodes", plugin.component, round, num_nodes));
+
         garbageCollect();
 
         _saveIterationAST(plugin, "AST after resolving", round);
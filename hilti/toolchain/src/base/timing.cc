@@ -87,11 +87,16 @@ void Manager::summary(std::ostream& out) {
 
     out << "\n=== Execution Time Summary ===\n\n";
 
-    for ( auto* ledger : sorted_ledgers )
+    for ( auto* ledger : sorted_ledgers ) {
         out << fmt("%7.2f%%  ",
                    (100 * static_cast<double>(ledger->_time_used.count()) / static_cast<double>(total_time.count())))
-            << fmt("%8s", prettyTimeForUnit(ledger->_time_used, 1e9, "s")) << "   " << ledger->_name << " "
-            << fmt("(#%" PRIu64 ")", ledger->_num_completed) << "\n";
+            << fmt("%8s", prettyTimeForUnit(ledger->_time_used, 1e9, "s")) << "   " << ledger->_name << " ";
+
+        if ( ledger->_num_items )
+            out << fmt("(#%" PRIu64 ", %" PRIu64 " items)", ledger->_num_completed, ledger->_num_items) << "\n";
+        else
+            out << fmt("(#%" PRIu64 ")", ledger->_num_completed) << "\n";
+    }
 
     out << "\nTotal time: " << prettyTime(total_time) << "\n";
     out << '\n';
@@ -567,6 +567,36 @@ struct GlobalsVisitor : hilti::visitor::PostOrder {
             auto body = cxx::Block();
             auto cb = cxx::Block();
 
+            // If all parameters marked with `&no-fiber-if-frozen` receive
+            // frozen streams, the function cannot suspend. In that case we
+            // skip the fiber and call the function directly on the caller's
+            // stack.
+            std::vector<std::string> frozen_conds;
+            for ( const auto& p : ft->parameters() ) {
+                if ( p->attributes()->find(hilti::attribute::kind::NoFiberIfFrozen) )
+                    frozen_conds.emplace_back(fmt("%s->isFrozen()", cxx::ID(p->id())));
+            }
+
+            if ( ! frozen_conds.empty() ) {
+                auto direct = cxx::Block();
+                auto direct_cb = cxx::Block();
+                cxx::Expression direct_call = fmt("%s(%s)", d.id, util::join(cxx_func.args, ", "));
+
+                if ( ! ft->result()->type()->isA<type::Void>() )
+                    direct_cb.addReturn(direct_call);
+                else {
+                    direct_cb.addStatement(direct_call);
+                    direct_cb.addReturn("::hilti::rt::Nothing()");
+                }
+
+                direct.addLambda("direct_cb", "[&]() -> ::hilti::rt::any", std::move(direct_cb));
+                direct.addReturn("::hilti::rt::context::executeDirectly(direct_cb)");
+
+                body.addIf(fmt("::hilti::rt::configuration::detail::unsafeGet().fiber_direct_execution && %s",
+                               util::join(frozen_conds, " && ")),
+                           std::move(direct));
+            }
+
             auto outer_args = util::join(cxx_func.args | std::views::transform([](auto& x) {
                                              return fmt("::hilti::rt::resumable::detail::copyArg(%s)", x.id);
                                          }),
@@ -884,6 +914,7 @@ Result<std::shared_ptr<cxx::Unit>> CodeGen::compileModule(declaration::Module* m
 
     _cxx_unit = std::make_unique<cxx::Unit>(context(), module);
     _hilti_module = module;
+    _profiler_slots.clear();
 
     _addCxxDeclarations(_cxx_unit.get());
 
@@ -946,7 +977,7 @@ cxx::Expression CodeGen::startProfiler(const std::string& name, cxx::Block* bloc
     assert(block);
     pushCxxBlock(block);
     auto id = addTmp("profiler", cxx::Type("::hilti::rt::Optional<::hilti::rt::Profiler>"));
-    auto stmt = cxx::Expression(fmt("%s = ::hilti::rt::profiler::start(\"%s\")", id, name));
+    auto stmt = cxx::Expression(fmt("%s = ::hilti::rt::profiler::start(%s)", id, profilerSlot(name)));
 
     if ( insert_at_front )
         cxxBlock()->addStatementAtFront(stmt);
@@ -957,6 +988,25 @@ cxx::Expression CodeGen::startProfiler(const std::string& name, cxx::Block* bloc
     return id;
 }
 
+cxx::Expression CodeGen::profilerSlot(const std::string& name) {
+    if ( auto i = _profiler_slots.find(name); i != _profiler_slots.end() )
+        return i->second;
+
+    auto id = cxx::ID(unit()->cxxInternalNamespace(),
+                      fmt("%s_%zu", HILTI_INTERNAL_ID("profiler_slot"), _profiler_slots.size()));
+
+    unit()->add(cxx::declaration::Global(id,
+                                         "const ::hilti::rt::profiler::Slot",
+                                         {},
+                                         fmt("::hilti::rt::profiler::slot(\"%s\")",
+                                             util::escapeUTF8(name, hilti::rt::render_style::UTF8::EscapeQuotes)),
+                                         "static"));
+
+    auto slot = cxx::Expression(std::string(id));
+    _profiler_slots.emplace(name, slot);
+    return slot;
+}
+
 void CodeGen::stopProfiler(const cxx::Expression& profiler, cxx::Block* block) {
     if ( ! options().enable_profiling )
         return;
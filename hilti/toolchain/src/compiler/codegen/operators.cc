@@ -365,9 +365,16 @@ struct Visitor : hilti::visitor::PreOrder {
         }
 
         const auto& values = n->op1()->as<expression::Ctor>()->ctor()->as<ctor::Tuple>()->value();
-        result = fmt("%s(%s)",
-                     name,
-                     util::join(cg->compileCallArguments(values, f->function()->ftype()->parameters()), ", "));
+        auto args = cg->compileCallArguments(values, f->function()->ftype()->parameters());
+
+        // When starting a profiler for a constant name, pass the slot
+        // allocated for it at load time instead, saving the lookup.
+        if ( f->fullyQualifiedID() == ID("hilti::profiler_start") && ! values.empty() ) {
+            if ( auto* c = values[0]->tryAs<expression::Ctor>(); c && c->ctor()->isA<ctor::String>() )
+                args[0] = cg->profilerSlot(c->ctor()->as<ctor::String>()->value());
+        }
+
+        result = fmt("%s(%s)", name, util::join(args, ", "));
     }
 
     // Interval
@@ -1139,6 +1146,12 @@ struct Visitor : hilti::visitor::PreOrder {
 
     void operator()(operator_::tuple::CustomAssign* n) final {
         auto t = n->operands()[0]->as<expression::Ctor>()->ctor()->as<ctor::Tuple>()->value();
+
+        if ( auto x = cg->unpackInPlace(t, n->op1()) ) {
+            result = std::move(x);
+            return;
+        }
+
         auto l = util::join(t | std::views::transform([this](auto x) { return cg->compile(x, true); }), ", ");
         result = {fmt("::hilti::rt::tuple::assign(std::tie(%s), %s)", l, op1(n)), Side::LHS};
     }
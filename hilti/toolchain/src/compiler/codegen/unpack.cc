@@ -5,9 +5,16 @@
 #include <string>
 #include <utility>
 
+#include <hilti/ast/ctors/coerced.h>
+#include <hilti/ast/ctors/tuple.h>
 #include <hilti/ast/expression.h>
+#include <hilti/ast/expressions/ctor.h>
+#include <hilti/ast/operators/generic.h>
+#include <hilti/ast/operators/result.h>
 #include <hilti/ast/type.h>
 #include <hilti/ast/types/integer.h>
+#include <hilti/ast/types/stream.h>
+#include <hilti/ast/types/type.h>
 #include <hilti/base/logger.h>
 #include <hilti/base/util.h>
 #include <hilti/compiler/detail/codegen/codegen.h>
@@ -145,3 +152,46 @@ cxx::Expression CodeGen::unpack(QualifiedType* t,
 
     logger().internalError("unpack failed to compile", t);
 }
+
+std::optional<cxx::Expression> CodeGen::unpackInPlace(const node::Range<Expression>& targets, Expression* src) {
+    if ( targets.size() != 2 )
+        return {};
+
+    auto* deref = src->tryAs<operator_::result::Deref>();
+    if ( ! deref )
+        return {};
+
+    auto* unpack = deref->op0()->tryAs<operator_::generic::Unpack>();
+    if ( ! unpack )
+        return {};
+
+    auto* t = unpack->op0()->type()->type()->as<type::Type_>()->typeValue()->type();
+
+    std::string cxx_type;
+    if ( auto* u = t->tryAs<type::UnsignedInteger>() )
+        cxx_type = fmt("uint%d_t", u->width());
+    else if ( auto* s = t->tryAs<type::SignedInteger>() )
+        cxx_type = fmt("int%d_t", s->width());
+    else
+        return {};
+
+    auto* ctor = unpack->op1()->as<expression::Ctor>()->ctor();
+    if ( auto* x = ctor->tryAs<ctor::Coerced>() )
+        ctor = x->coercedCtor();
+
+    auto args = ctor->as<ctor::Tuple>()->value();
+    if ( args.size() != 2 || ! args[0]->type()->type()->isA<type::stream::View>() )
+        return {};
+
+    // The view we unpack from must be the one we assign the remainder to.
+    auto data = compile(args[0], true);
+    if ( data != compile(targets[1], true) )
+        return {};
+
+    return cxx::Expression(fmt("(%s = ::hilti::rt::integer::unpackAndAdvance<%s>(%s, %s))",
+                               compile(targets[0], true),
+                               cxx_type,
+                               data,
+                               compile(args[1])),
+                           Side::LHS);
+}
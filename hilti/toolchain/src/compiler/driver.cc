@@ -6,11 +6,14 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
 #include <exception>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <ranges>
 #include <system_error>
+#include <thread>
 #include <utility>
 
 #include <hilti/rt/libhilti.h>
@@ -749,15 +752,67 @@ Result<Nothing> Driver::_codegenUnits() {
         // No need to kick off code generation.
         return Nothing();
 
+    std::vector<Unit*> units;
+
     for ( auto& [uid, unit] : _units ) {
         if ( ! unit->isCompiledHILTI() )
             continue;
 
         HILTI_DEBUG(logging::debug::Driver, fmt("codegen for input unit %s", unit->uid().str()));
 
-        if ( auto rc = unit->codegen(); ! rc )
+        if ( auto rc = unit->lowerToCxx(); ! rc )
             return augmentError(rc.error());
 
+        units.push_back(unit.get());
+    }
+
+    // Rendering the C++ code no longer touches the AST, so we do that for
+    // all units in parallel. Exceptions must not escape the worker threads,
+    // we pass them on to the main thread to rethrow them there.
+    util::timing::Collector finalize_timer("hilti/compiler/codegen/finalize");
+    finalize_timer.addItems(units.size());
+
+    std::vector<std::optional<result::Error>> errors(units.size());
+    std::vector<std::exception_ptr> exceptions(units.size());
+    std::atomic<size_t> next = 0;
+
+    auto finalize = [&]() {
+        for ( size_t i = next++; i < units.size(); i = next++ ) {
+            try {
+                if ( auto rc = units[i]->finalizeCxx(); ! rc )
+                    errors[i] = rc.error();
+            } catch ( ... ) {
+                exceptions[i] = std::current_exception();
+            }
+        }
+    };
+
+    // Starting threads costs more than rendering a few small units takes, so
+    // we give each thread a couple of units at least, and cap their number.
+    constexpr size_t MaxFinalizeThreads = 8;
+    constexpr size_t MinUnitsPerThread = 4;
+    auto concurrency = std::min({units.size() / MinUnitsPerThread,
+                                 static_cast<size_t>(std::thread::hardware_concurrency()),
+                                 MaxFinalizeThreads});
+
+    std::vector<std::thread> threads;
+    for ( size_t i = 1; i < concurrency; i++ )
+        threads.emplace_back(finalize);
+
+    finalize(); // use the current thread as well
+
+    for ( auto& t : threads )
+        t.join();
+
+    for ( size_t i = 0; i < units.size(); i++ ) {
+        auto* unit = units[i];
+
+        if ( exceptions[i] )
+            std::rethrow_exception(exceptions[i]);
+
+        if ( errors[i] )
+            return augmentError(*errors[i]);
+
         if ( ! unit->module()->skipImplementation() ) {
             if ( auto md = unit->linkerMetaData() )
                 _mds.push_back(*md);
@@ -976,13 +1031,23 @@ Result<Nothing> Driver::outputUnits() {
                         cxx_path = fmt("%s_%s.cc", _driver_options.output_cxx_prefix, cxx->id());
                 }
 
-                auto output = openOutput(cxx_path, false, append);
-                if ( ! output )
-                    return output.error();
-
-                HILTI_DEBUG(logging::debug::Driver,
-                            fmt("saving C++ code for module %s to %s", unit->uid().str(), cxx_path));
-                cxx->save(**output);
+                // When writing individual files, leave any that already
+                // have the same code alone. That keeps their modification
+                // times unchanged so that build systems will recompile only
+                // modules whose code actually changed.
+                if ( _driver_options.output_cxx_prefix.size() && CxxCode(cxx_path).code() == cxx->code() ) {
+                    HILTI_DEBUG(logging::debug::Driver,
+                                fmt("C++ code for module %s unchanged, keeping %s", unit->uid().str(), cxx_path));
+                }
+                else {
+                    auto output = openOutput(cxx_path, false, append);
+                    if ( ! output )
+                        return output.error();
+
+                    HILTI_DEBUG(logging::debug::Driver,
+                                fmt("saving C++ code for module %s to %s", unit->uid().str(), cxx_path));
+                    cxx->save(**output);
+                }
             }
 
             if ( _driver_options.output_prototypes ) {
@@ -5,12 +5,17 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -51,9 +56,24 @@ namespace {
 
 const auto UserDiagnosticsFile = rt::filesystem::path("hilti-jit-error.log");
 
-hilti::rt::filesystem::path save(const CxxCode& code, const hilti::rt::filesystem::path& id, std::size_t hash) {
-    const auto cc_hash = code.hash();
+// Returns the name of the file that `save()` writes C++ code into.
+std::string cxxFileName(const CxxCode& code, const hilti::rt::filesystem::path& id, std::size_t hash) {
+    return util::fmt("%s_%" PRIx64 "-%" PRIx64 ".cc", id.stem().generic_string(), hash, code.hash());
+}
 
+// Returns the path of the object file to compile a C++ file into.
+hilti::rt::filesystem::path objectFile(const std::string& cc, std::size_t hash) {
+    // We explicitly create the object file in the temporary directory.
+    // This ensures that we use a temp path for object files created for
+    // C++ files added by users as well.
+#ifdef _MSC_VER
+    return hilti::rt::filesystem::temp_directory_path() / util::fmt("%s_%" PRIx64 ".obj", cc, hash);
+#else
+    return hilti::rt::filesystem::temp_directory_path() / util::fmt("%s_%" PRIx64 ".o", cc, hash);
+#endif
+}
+
+hilti::rt::filesystem::path save(const CxxCode& code, const hilti::rt::filesystem::path& id, std::size_t hash) {
     // Create a random temporary file owned only by us so we are not racing
     // with other processes attempting to create the same output file.
     //
@@ -62,8 +82,7 @@ hilti::rt::filesystem::path save(const CxxCode& code, const hilti::rt::filesyste
     auto cc0 = hilti::rt::createTemporaryFile("spicy-jit-cc");
     if ( ! cc0 )
         rt::fatalError(util::fmt("could not create temporary file: %s", cc0.error()));
-    auto cc1 =
-        cc0->parent_path() / util::fmt("%s_%" PRIx64 "-%" PRIx64 ".cc", id.stem().generic_string(), hash, cc_hash);
+    auto cc1 = cc0->parent_path() / cxxFileName(code, id, hash);
 
     std::ofstream out(cc0->string());
 
@@ -113,6 +132,270 @@ private:
     std::vector<hilti::rt::filesystem::path> _paths;
 };
 
+// Returns the output of running the C++ compiler to report its version, or
+// an empty string if that fails.
+std::string compilerVersion(const hilti::rt::filesystem::path& cxx) {
+#ifdef _WIN32
+    // cl.exe prints its version banner when run without arguments.
+    std::vector<std::string> args = {cxx.string()};
+#else
+    std::vector<std::string> args = {cxx.string(), "--version"};
+#endif
+
+    reproc::process process;
+    if ( auto ec = process.start(args) ) {
+        HILTI_DEBUG(logging::debug::Jit, util::fmt("could not determine version of %s: %s", cxx, ec.message()));
+        return "";
+    }
+
+    std::string output;
+    reproc::drain(process, reproc::sink::string(output), reproc::sink::string(output));
+    process.wait(reproc::infinite);
+    return output;
+}
+
+// Computes hashes over the content of all headers that C++ code includes,
+// directly or indirectly, from the include directories passed to the
+// compiler. Headers not found there, like the system's, are covered by the
+// compiler's version instead. Hashes of individual headers are computed
+// only once per instance.
+class HeaderHasher {
+public:
+    HeaderHasher(const std::vector<std::string>& flags) {
+        for ( auto i = flags.begin(); i != flags.end(); ++i ) {
+            if ( *i == "-I" && i + 1 != flags.end() )
+                _dirs.emplace_back(*++i);
+            else if ( util::startsWith(*i, "-I") )
+                _dirs.emplace_back(i->substr(2));
+        }
+    }
+
+    // Returns a hash over all headers included by the given code.
+    std::size_t hash(const CxxCode& code) {
+        if ( ! code.code() )
+            return 0;
+
+        std::size_t h = 0;
+        std::set<hilti::rt::filesystem::path> seen;
+
+        for ( const auto& header : _includes(*code.code(), {}) )
+            h = hilti::rt::hashCombine(h, _hash(header, &seen));
+
+        return h;
+    }
+
+private:
+    // Returns the headers that C++ code includes, resolved against the
+    // include directories, or `dir` for quoted includes.
+    std::vector<hilti::rt::filesystem::path> _includes(const std::string& code,
+                                                       const hilti::rt::filesystem::path& dir) const {
+        std::vector<hilti::rt::filesystem::path> includes;
+        std::istringstream in(code);
+        std::string line;
+
+        while ( std::getline(in, line) ) {
+            auto l = util::trim(line);
+            if ( ! util::startsWith(l, "#") )
+                continue;
+
+            l = util::trim(l.substr(1));
+            if ( ! util::startsWith(l, "include") )
+                continue;
+
+            l = util::trim(l.substr(7));
+            if ( l.size() < 2 || (l[0] != '<' && l[0] != '"') )
+                continue;
+
+            auto end = l.find(l[0] == '<' ? '>' : '"', 1);
+            if ( end == std::string::npos )
+                continue;
+
+            auto name = l.substr(1, end - 1);
+
+            std::error_code ec;
+            if ( l[0] == '"' && ! dir.empty() && hilti::rt::filesystem::is_regular_file(dir / name, ec) ) {
+                includes.emplace_back(dir / name);
+                continue;
+            }
+
+            for ( const auto& d : _dirs ) {
+                if ( hilti::rt::filesystem::is_regular_file(d / name, ec) ) {
+                    includes.emplace_back(d / name);
+                    break;
+                }
+            }
+        }
+
+        return includes;
+    }
+
+    // Returns a hash over a header's content and, recursively, that of all
+    // headers it includes that have not been seen yet.
+    std::size_t _hash(const hilti::rt::filesystem::path& header, std::set<hilti::rt::filesystem::path>* seen) {
+        std::error_code ec;
+        auto path = hilti::rt::filesystem::weakly_canonical(header, ec);
+        if ( ec )
+            path = header;
+
+        if ( ! seen->insert(path).second )
+            return 0;
+
+        auto i = _headers.find(path);
+        if ( i == _headers.end() ) {
+            std::ifstream in(path);
+            std::string content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+            i = _headers.emplace(path, Header{std::hash<std::string>{}(content), _includes(content, path.parent_path())})
+                    .first;
+        }
+
+        auto h = i->second.hash;
+        for ( const auto& include : i->second.includes )
+            h = hilti::rt::hashCombine(h, _hash(include, seen));
+
+        return h;
+    }
+
+    struct Header {
+        std::size_t hash;                                   // hash of the header's content
+        std::vector<hilti::rt::filesystem::path> includes; // headers it includes
+    };
+
+    std::vector<hilti::rt::filesystem::path> _dirs;
+    std::map<hilti::rt::filesystem::path, Header> _headers;
+};
+
+// Persistent cache of object files compiled during JIT. Entries are keyed by
+// a hash of the C++ code along with a hash of everything else going into its
+// compilation: the compiler and its version, its flags, the headers the code
+// includes, and the HILTI version. Once the cache exceeds its maximum size,
+// we evict the least recently used entries, using the files' modification
+// times to track their last use.
+class ObjectCache {
+public:
+    ObjectCache(hilti::rt::filesystem::path dir, uint64_t max_size) : _dir(std::move(dir)), _max_size(max_size) {}
+
+    // Returns a cache configured through `HILTI_JIT_CACHE_DIR` and
+    // `HILTI_JIT_CACHE_SIZE`, or nothing if caching is disabled.
+    static std::optional<ObjectCache> fromEnvironment() {
+        auto env = hilti::rt::getenv("HILTI_JIT_CACHE_DIR");
+        if ( ! env || env->empty() )
+            return {};
+
+        auto dir = hilti::rt::filesystem::path(std::string(*env));
+
+        uint64_t max_size = 1024; // MB
+        if ( auto size = hilti::rt::getenv("HILTI_JIT_CACHE_SIZE") )
+            max_size = util::charsToUInt64(std::string(*size).c_str(), 10, [&]() {
+                rt::fatalError(
+                    util::fmt("expected unsigned integer but received '%s' for HILTI_JIT_CACHE_SIZE", *size));
+            });
+
+        std::error_code ec;
+        hilti::rt::filesystem::create_directories(dir, ec);
+        if ( ec ) {
+            logger().warning(
+                util::fmt("cannot create JIT cache directory %s, disabling cache: %s", dir, ec.message()));
+            return {};
+        }
+
+        return ObjectCache(std::move(dir), max_size * 1024 * 1024);
+    }
+
+    // Copies the object file cached for a key to *obj*. Returns false if
+    // there's no such entry.
+    bool lookup(std::size_t config, const CxxCode& code, const hilti::rt::filesystem::path& obj) const {
+        auto entry = _entry(config, code);
+
+        std::error_code ec;
+        if ( ! hilti::rt::filesystem::exists(entry, ec) )
+            return false;
+
+        // We copy the entry rather than linking to it: another process may
+        // evict it concurrently, and a later compile writing the object file
+        // in place must not modify the cached entry through a shared inode.
+        hilti::rt::filesystem::copy_file(entry, obj, hilti::rt::filesystem::copy_options::overwrite_existing, ec);
+        if ( ec )
+            return false;
+
+        // Mark the entry as recently used; ignore errors.
+        hilti::rt::filesystem::last_write_time(entry, hilti::rt::filesystem::file_time_type::clock::now(), ec);
+        return true;
+    }
+
+    // Records an object file in the cache.
+    void store(std::size_t config, const CxxCode& code, const hilti::rt::filesystem::path& obj) const {
+        // Copy to a temporary file first, then atomically move it into place
+        // so that concurrent lookups always see complete entries.
+        auto entry = _entry(config, code);
+        auto tmp = entry;
+        tmp += util::fmt(".tmp-%08x", std::random_device()());
+
+        std::error_code ec;
+        hilti::rt::filesystem::copy_file(obj, tmp, hilti::rt::filesystem::copy_options::overwrite_existing, ec);
+        if ( ! ec )
+            hilti::rt::filesystem::rename(tmp, entry, ec);
+
+        if ( ec ) {
+            HILTI_DEBUG(logging::debug::Jit,
+                        util::fmt("could not add %s to JIT cache: %s", obj.generic_string(), ec.message()));
+            hilti::rt::filesystem::remove(tmp, ec);
+        }
+    }
+
+    // Evicts the least recently used entries until the cache's total size
+    // is within its limit.
+    void evict() const {
+        struct Entry {
+            hilti::rt::filesystem::path path;
+            hilti::rt::filesystem::file_time_type last_use;
+            uint64_t size;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t total = 0;
+
+        std::error_code ec;
+        for ( const auto& f : hilti::rt::filesystem::directory_iterator(_dir, ec) ) {
+            if ( ! f.is_regular_file(ec) )
+                continue;
+
+            auto last_use = f.last_write_time(ec);
+            auto size = f.file_size(ec);
+            if ( ec )
+                continue;
+
+            entries.push_back(Entry{.path = f.path(), .last_use = last_use, .size = size});
+            total += size;
+        }
+
+        if ( total <= _max_size )
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.last_use < b.last_use; });
+
+        for ( const auto& e : entries ) {
+            if ( total <= _max_size )
+                break;
+
+            HILTI_DEBUG(logging::debug::Jit, util::fmt("evicting %s from JIT cache", e.path.generic_string()));
+            hilti::rt::filesystem::remove(e.path, ec);
+            total -= e.size;
+        }
+    }
+
+private:
+    hilti::rt::filesystem::path _entry(std::size_t config, const CxxCode& code) const {
+#ifdef _MSC_VER
+        return _dir / util::fmt("%016" PRIx64 "-%016" PRIx64 ".obj", config, code.hash());
+#else
+        return _dir / util::fmt("%016" PRIx64 "-%016" PRIx64 ".o", config, code.hash());
+#endif
+    }
+
+    hilti::rt::filesystem::path _dir;
+    uint64_t _max_size;
+};
+
 } // namespace
 
 namespace hilti::logging::debug {
@@ -306,7 +589,69 @@ hilti::Result<Nothing> JIT::_compile() {
     if ( ! hasInputs() )
         return Nothing();
 
-    auto cc_files = _files;
+    // Assemble the flags we pass to the compiler for all files.
+    std::vector<std::string> flags = {"-c"};
+
+    if ( options().debug )
+        flags = hilti::util::concat(flags, hilti::configuration().hlto_cxx_flags_debug);
+    else
+        flags = hilti::util::concat(flags, hilti::configuration().hlto_cxx_flags_release);
+
+    // For debug output on compilation:
+    // flags.push_back("-v");
+    // flags.push_back("-###");
+
+    for ( const auto& i : options().cxx_include_paths ) {
+        flags.emplace_back("-I");
+        flags.push_back(i.string());
+    }
+
+    if ( auto path = hilti::rt::getenv("HILTI_CXX_INCLUDE_DIRS") ) {
+#ifdef _WIN32
+        for ( auto&& dir : hilti::rt::split(*path, ";") ) {
+#else
+        for ( auto&& dir : hilti::rt::split(*path, ":") ) {
+#endif
+            if ( ! dir.empty() ) {
+                flags.insert(flags.begin(), {"-I", std::string(dir)});
+            }
+        }
+    }
+
+    if ( auto flags_ = hilti::rt::getenv("HILTI_CXX_FLAGS") ) {
+        if ( auto addl = util::splitShellUnsafe(*flags_) )
+            flags.insert(flags.end(), std::make_move_iterator(addl->begin()), std::make_move_iterator(addl->end()));
+        else
+            return result::Error(util::fmt("invalid HILTI_CXX_FLAGS '%s': %s", *flags_, addl.error().description()));
+    }
+
+    auto cxx = hilti::configuration().cxx;
+    std::optional<hilti::rt::filesystem::path> launcher;
+    if ( const auto& l = hilti::configuration().cxx_launcher; l && ! l->empty() )
+        launcher = *l;
+
+    // If we have a cache for object files, reuse any previously compiled
+    // code. Cache entries depend on everything going into the compilation
+    // besides the code itself. We summarize what's the same for all code in
+    // a single hash, and add the headers that each piece of code includes.
+    auto cache = ObjectCache::fromEnvironment();
+    std::size_t cache_config = 0;
+    std::optional<HeaderHasher> headers;
+
+    if ( cache ) {
+        cache_config = std::hash<std::string>{}(util::fmt("%s|%s|%s|%s",
+                                                          hilti::configuration().version_string_long,
+                                                          cxx.string(),
+                                                          compilerVersion(cxx),
+                                                          util::join(flags, " ")));
+        headers.emplace(flags);
+    }
+
+    // C++ files to compile, along with the code and cache key to cache their
+    // object file for.
+    std::vector<std::tuple<hilti::rt::filesystem::path, const CxxCode*, std::size_t>> cc_files;
+    for ( const auto& path : _files )
+        cc_files.emplace_back(path, nullptr, 0);
 
     // Remember generated files and remove them on all exit paths.
     bool keep_tmps = options().keep_tmps;
@@ -318,6 +663,25 @@ hilti::Result<Nothing> JIT::_compile() {
         if ( id.empty() )
             id = "code"; // dummy name
 
+        std::size_t config = 0;
+
+        if ( cache && ! _dump_code ) {
+            util::timing::Collector lookup("hilti/jit/cache/lookup");
+
+            config = hilti::rt::hashCombine(cache_config, headers->hash(code));
+
+            auto obj = objectFile(cxxFileName(code, id, _hash), _hash);
+            if ( cache->lookup(config, code, obj) ) {
+                HILTI_DEBUG(logging::debug::Jit, util::fmt("JIT cache hit for %s", id));
+                ++_cache_statistics.hits;
+                _objects.push_back(std::move(obj));
+                continue;
+            }
+
+            HILTI_DEBUG(logging::debug::Jit, util::fmt("JIT cache miss for %s", id));
+            ++_cache_statistics.misses;
+        }
+
         auto cc = save(code, id, _hash);
 
         if ( _dump_code ) {
@@ -332,78 +696,46 @@ hilti::Result<Nothing> JIT::_compile() {
                                         ec); // will save into current directory; ignore errors
         }
 
-        cc_files.push_back(cc);
+        cc_files.emplace_back(cc, &code, config);
         if ( ! keep_tmps )
             cc_files_generated.add(std::move(cc));
     }
 
     // Compile all C++ files.
     std::vector<result::Error> errors;
-    for ( const auto& path : cc_files ) {
-        HILTI_DEBUG(logging::debug::Jit, util::fmt("compiling %s", path.filename().generic_string()));
-
-        std::vector<std::string> args = {"-c"};
-
-        if ( options().debug )
-            args = hilti::util::concat(args, hilti::configuration().hlto_cxx_flags_debug);
-        else
-            args = hilti::util::concat(args, hilti::configuration().hlto_cxx_flags_release);
-
-        // For debug output on compilation:
-        // args.push_back("-v");
-        // args.push_back("-###");
+    std::vector<std::tuple<const CxxCode*, std::size_t, hilti::rt::filesystem::path>> to_cache;
 
-        for ( const auto& i : options().cxx_include_paths ) {
-            args.emplace_back("-I");
-            args.push_back(i.string());
-        }
+    for ( const auto& [path, code, config] : cc_files ) {
+        HILTI_DEBUG(logging::debug::Jit, util::fmt("compiling %s", path.filename().generic_string()));
 
-        if ( auto path = hilti::rt::getenv("HILTI_CXX_INCLUDE_DIRS") ) {
-#ifdef _WIN32
-            for ( auto&& dir : hilti::rt::split(*path, ";") ) {
-#else
-            for ( auto&& dir : hilti::rt::split(*path, ":") ) {
-#endif
-                if ( ! dir.empty() ) {
-                    args.insert(args.begin(), {"-I", std::string(dir)});
-                }
-            }
-        }
+        auto args = flags;
+        auto obj = objectFile(path.filename().generic_string(), _hash);
 
-        if ( auto flags_ = hilti::rt::getenv("HILTI_CXX_FLAGS") ) {
-            if ( auto flags = util::splitShellUnsafe(*flags_) )
-                args.insert(args.end(), std::make_move_iterator(flags->begin()), std::make_move_iterator(flags->end()));
-            else
-                return result::Error(
-                    util::fmt("invalid HILTI_CXX_FLAGS '%s': %s", *flags_, flags.error().description()));
-        }
+        // Don't let the compiler write into a file left over from a previous
+        // run, which may be shared with a JIT cache entry.
+        std::error_code ec;
+        hilti::rt::filesystem::remove(obj, ec);
 
-        // We explicitly create the object file in the temporary directory.
-        // This ensures that we use a temp path for object files created for
-        // C++ files added by users as well.
 #ifdef _MSC_VER
-        auto obj = hilti::rt::filesystem::temp_directory_path() /
-                   util::fmt("%s_%" PRIx64 ".obj", path.filename().generic_string(), _hash);
-
         args.emplace_back(util::fmt("/Fo%s", obj.string()));
 #else
-        auto obj = hilti::rt::filesystem::temp_directory_path() /
-                   util::fmt("%s_%" PRIx64 ".o", path.filename().generic_string(), _hash);
-
         args.emplace_back("-o");
         args.push_back(obj.string());
 #endif
+        if ( cache && code && ! _dump_code )
+            to_cache.emplace_back(code, config, obj);
+
         _objects.push_back(std::move(obj));
 
         args.push_back(hilti::rt::filesystem::canonical(path).string());
 
-        auto cxx = hilti::configuration().cxx;
-        if ( const auto& launcher = hilti::configuration().cxx_launcher; launcher && ! launcher->empty() ) {
+        auto cmd = cxx;
+        if ( launcher ) {
             args.insert(args.begin(), cxx.string());
-            cxx = *launcher;
+            cmd = *launcher;
         }
 
-        if ( auto rc = _runner._scheduleJob(cxx, std::move(args)); ! rc )
+        if ( auto rc = _runner._scheduleJob(cmd, std::move(args)); ! rc )
             errors.push_back(rc.error());
     }
 
@@ -413,6 +745,18 @@ hilti::Result<Nothing> JIT::_compile() {
     if ( ! errors.empty() )
         return errors.front();
 
+    if ( cache ) {
+        for ( const auto& [code, config, obj] : to_cache )
+            cache->store(config, *code, obj);
+
+        cache->evict();
+
+        HILTI_DEBUG(logging::debug::Jit,
+                    util::fmt("JIT cache: %" PRIu64 " hits, %" PRIu64 " misses",
+                              _cache_statistics.hits,
+                              _cache_statistics.misses));
+    }
+
     return Nothing();
 }
 
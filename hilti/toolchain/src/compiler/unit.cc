@@ -86,6 +86,13 @@ Result<std::shared_ptr<detail::cxx::Unit>> Unit::_codegenModule(const declaratio
 }
 
 Result<Nothing> Unit::codegen() {
+    if ( auto x = lowerToCxx(); ! x )
+        return x.error();
+
+    return finalizeCxx();
+}
+
+Result<Nothing> Unit::lowerToCxx() {
     if ( ! _uid )
         return Nothing();
 
@@ -96,14 +103,22 @@ Result<Nothing> Unit::codegen() {
     if ( ! cxx )
         return cxx.error();
 
+    _cxx_unit = *cxx;
+
+    // Log this here, `finalizeCxx()` may run off the main thread.
     HILTI_DEBUG(logging::debug::Compiler, fmt("finalizing module %s", _uid));
-    if ( auto x = (*cxx)->finalize(); ! x )
-        return x.error();
 
-    _cxx_unit = *cxx;
     return Nothing();
 }
 
+Result<Nothing> Unit::finalizeCxx() {
+    if ( ! (_uid && _cxx_unit) )
+        return Nothing();
+
+    // No logging here, we may be running concurrently with other units.
+    return _cxx_unit->finalize();
+}
+
 Result<CxxCode> Unit::cxxCode() const {
     if ( ! _cxx_unit )
         return result::Error("no C++ code available for unit");
@@ -48,7 +48,9 @@
 #include <hilti/ast/types/name.h>
 #include <hilti/ast/types/null.h>
 #include <hilti/ast/types/optional.h>
+#include <hilti/ast/types/reference.h>
 #include <hilti/ast/types/result.h>
+#include <hilti/ast/types/stream.h>
 #include <hilti/ast/types/string.h>
 #include <hilti/ast/types/tuple.h>
 #include <hilti/ast/types/union.h>
@@ -78,7 +80,8 @@ static std::unordered_map<node::Tag, std::unordered_set<attribute::Kind>> allowe
       attribute::kind::NeededByFeature,
       attribute::kind::Debug,
       attribute::kind::Public}},
-    {node::tag::declaration::Parameter, {attribute::kind::CxxAnyAsPtr, attribute::kind::RequiresTypeFeature}},
+    {node::tag::declaration::Parameter,
+     {attribute::kind::CxxAnyAsPtr, attribute::kind::NoFiberIfFrozen, attribute::kind::RequiresTypeFeature}},
 };
 
 void hilti::validator::VisitorMixIn::deprecated(const std::string& msg, const Location& l) const {
@@ -288,6 +291,17 @@ struct VisitorPost : visitor::PreOrder, public validator::VisitorMixIn {
                 if ( ! p->type()->type()->isA<type::Any>() )
                     error(fmt("parameter '%s' must be of type 'any' to use &cxx-any-as-ptr", p->id()), n);
             }
+
+            if ( p->attributes()->find(hilti::attribute::kind::NoFiberIfFrozen) ) {
+                if ( n->ftype()->callingConvention() != type::function::CallingConvention::Extern )
+                    error(fmt("parameter '%s' cannot have &no-fiber-if-frozen in a non-extern function", p->id()), n);
+
+                auto* t = p->type()->type();
+                if ( ! (t->isA<type::ValueReference>() && t->dereferencedType()->type()->isA<type::Stream>()) )
+                    error(fmt("parameter '%s' must be of type 'value_ref<stream>' to use &no-fiber-if-frozen",
+                              p->id()),
+                          n);
+            }
         }
     }
 
@@ -311,6 +325,15 @@ struct VisitorPost : visitor::PreOrder, public validator::VisitorMixIn {
             VisitorPost* outer_ = nullptr;
             VisitExpressions(VisitorPost* outer) : outer_(outer) {}
             void operator()(hilti::expression::Name* x) override {
+                // Calling functions implemented by the C++ runtime is fine,
+                // they don't depend on other globals being initialized.
+                if ( auto* d = x->resolvedDeclaration();
+                     d && x->parent() && x->parent()->isA<operator_::function::Call>() ) {
+                    if ( auto* f = d->tryAs<declaration::Function>();
+                         f && f->function()->attributes()->find(attribute::kind::Cxxname) )
+                        return;
+                }
+
                 outer_->error("'const' initialization cannot refer to other IDs", x);
             }
         };
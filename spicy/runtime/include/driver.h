@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <iosfwd>
 #include <string>
 #include <utility>
 
@@ -262,20 +264,39 @@ public:
      * format. See the documentation of `spicy-driver` for a reference of the
      * batch format.
      *
+     * With more than one thread, flows and connections are distributed
+     * across worker threads by their IDs, with each worker running inside
+     * its own HILTI runtime context. All output that processing produces is
+     * buffered per batch command and then written to stdout in the order of
+     * the commands, so that it comes out the same as with a single thread.
+     * That requires parsers to be compiled with dynamic globals, an error
+     * will be returned otherwise.
+     *
      * @param in an open stream to read the batch from
+     * @param threads number of worker threads to process the batch with; if
+     * zero or one, processing happens inside the calling thread
      * @returns appropriate error if there was a problem processing the batch
      */
-    hilti::rt::Result<hilti::rt::Nothing> processPreBatchedInput(std::istream& in);
+    hilti::rt::Result<hilti::rt::Nothing> processPreBatchedInput(std::istream& in, unsigned int threads = 1);
 
     /** Records a debug message to the `spicy-driver` runtime debug stream. */
     void debug(const std::string& msg);
 
 private:
+    struct BatchCommand;
+    struct BatchState;
+    struct BatchWorker;
+
+    // Reads the next command from a batch, returning false at end of input.
+    static hilti::rt::Result<bool> _readBatchCommand(std::istream& in, BatchCommand* cmd);
+    void _processBatchCommand(BatchState* state, const BatchCommand& cmd, std::ostream& out);
+    hilti::rt::Result<hilti::rt::Nothing> _processPreBatchedInputThreaded(std::istream& in, unsigned int threads);
+
     void _debugStats(const hilti::rt::ValueReference<hilti::rt::Stream>& data);
     void _debugStats(size_t current_flows, size_t current_connections);
 
-    uint64_t _total_flows = 0;
-    uint64_t _total_connections = 0;
+    std::atomic<uint64_t> _total_flows = 0;
+    std::atomic<uint64_t> _total_connections = 0;
 };
 
 } // namespace spicy::rt
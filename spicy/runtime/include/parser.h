@@ -17,6 +17,7 @@
 #include <hilti/rt/types/null.h>
 #include <hilti/rt/types/port.h>
 #include <hilti/rt/types/reference.h>
+#include <hilti/rt/types/regexp.h>
 #include <hilti/rt/types/string.h>
 #include <hilti/rt/types/struct.h>
 #include <hilti/rt/types/tuple.h>
@@ -408,6 +409,12 @@ public:
 
     ParseError(const hilti::rt::result::Error& e) : RecoverableFailure(e.description()) {}
 
+    /**
+     * Constructor for errors whose message is rendered only when it's
+     * actually needed, see `hilti::rt::exception::Deferred`.
+     */
+    ParseError(hilti::rt::exception::Deferred deferred) : RecoverableFailure(std::move(deferred)) {}
+
     ~ParseError() override; /* required to create vtable, see hilti::rt::Exception */
 };
 
@@ -565,8 +572,10 @@ extern void waitForInputSlow(hilti::rt::ValueReference<hilti::rt::Stream>& data,
  * @param data current input data
  * @param cur view of *data* that's being parsed
  * @param min desired number of bytes
- * @param error_msg message to report with parse error if end-of-data is been reached
- * @param location location associated with the situation
+ * @param error_msg message to report with parse error if end-of-data is been
+ * reached; must remain valid like *location*
+ * @param location location associated with the situation; must remain valid
+ * for the lifetime of any resulting error, as normally a string literal does
  * @param filter filter state associated with current unit instance (which may be null)
  */
 inline void waitForInput(hilti::rt::ValueReference<hilti::rt::Stream>& data, // NOLINT(google-runtime-references)
@@ -618,8 +627,10 @@ extern bool waitForInputOrEod(hilti::rt::ValueReference<hilti::rt::Stream>& data
  *
  * @param data current input data
  * @param cur view of *data* that's being parsed
- * @param error_msg message to report with parse error if end-of-data is been reached
- * @param location location associated with the situation
+ * @param error_msg message to report with parse error if end-of-data is been
+ * reached; must remain valid like *location*
+ * @param location location associated with the situation; must remain valid
+ * for the lifetime of any resulting error, as normally a string literal does
  * @param filter filter state associated with current unit instance (which may be null)
  * @return true if minimum number of bytes are available; false if end-of-data
  * has been reached
@@ -672,6 +683,50 @@ hilti::rt::Optional<hilti::rt::stream::SafeConstIterator> unitFind(
     const hilti::rt::Bytes& needle,
     hilti::rt::stream::Direction d);
 
+/**
+ * Precompiles a constant needle for use with `findLiteral()`. Generated code
+ * stores the result in a constant so that it gets computed only once per
+ * process.
+ *
+ * @param needle data to search
+ * @returns searcher for *needle*
+ */
+inline hilti::rt::stream::Searcher createSearcher(const hilti::rt::Bytes& needle) {
+    return hilti::rt::stream::Searcher(needle);
+}
+
+/**
+ * Wrapper around hilti::rt::stream::View::find() that searches for a
+ * precompiled needle.
+ *
+ * @param cur view to search
+ * @param needle searcher for the data to search
+ * @returns tuple with the same semantics as `View::find()`: if not found, the
+ * iterator points to the first position where a match may still start once
+ * more data becomes available
+ */
+inline hilti::rt::Tuple<bool, hilti::rt::stream::SafeConstIterator> findLiteral(
+    const hilti::rt::stream::View& cur, const hilti::rt::stream::Searcher& needle) {
+    return cur.find(needle);
+}
+
+/**
+ * Advances a view to the first position where a match of a regular
+ * expression may start, as far as that can be told from the data currently
+ * available. Synchronization uses this to skip over input that cannot begin
+ * a sync token. This never moves past the beginning of a gap, nor past the
+ * next multiple of *block_size* so that callers can still report progress at
+ * each block boundary.
+ *
+ * @param cur view to advance
+ * @param re regular expression to find candidate positions for
+ * @param block_size size of blocks whose boundaries not to skip over; zero for no limit
+ * @returns *cur* advanced to the first candidate position, or as far as
+ * allowed if there's none
+ */
+hilti::rt::stream::View skipToRegExpCandidate(const hilti::rt::stream::View& cur, const hilti::rt::RegExp& re,
+                                              uint64_t block_size);
+
 /**
  * Extracts a given number of bytes from a stream view.
  *
@@ -680,7 +735,8 @@ hilti::rt::Optional<hilti::rt::stream::SafeConstIterator> unitFind(
  * @param size number of bytes to extract
  * @param eod_ok if true, it's ok if end-of-data is reached without *size*
  * behind reached; otherwise an error will be triggered in that case
- * @param location location associated with the situation
+ * @param location location associated with the situation; must remain valid
+ * for the lifetime of any resulting error, as normally a string literal does
  * @param filters filter state associated with current unit instance (which may be null)
  * @returns extracted bytes
  * @throws ParseError if not enough data is available
@@ -698,7 +754,8 @@ hilti::rt::Bytes extractBytes(hilti::rt::ValueReference<hilti::rt::Stream>& data
  * @param data stream view to extract from
  * @param cur view of *data* that's being parsed
  * @param literal raw bytes representation of the literal to extract
- * @param location location associated with the situation
+ * @param location location associated with the situation; must remain valid
+ * for the lifetime of any resulting error, as normally a string literal does
  * @param filters filter state associated with current unit instance (which may be null)
  * @returns `literal` (for convenience)
  * @throws ParseError if the literal isn't found at the beginning of *cur*
@@ -709,5 +766,26 @@ void expectBytesLiteral(hilti::rt::ValueReference<hilti::rt::Stream>& data,
                         std::string_view location,
                         const hilti::rt::StrongReference<spicy::rt::filter::detail::Filters>& filters);
 
+/**
+ * Confirms that a stream view begins with a given bytes literal. This is a
+ * version of `expectBytesLiteral()` that returns a mismatch instead of
+ * throwing it, for generated code that handles the failure locally.
+ *
+ * @param data stream view to extract from
+ * @param cur view of *data* that's being parsed
+ * @param literal raw bytes representation of the literal to extract
+ * @param location location associated with the situation; must remain valid
+ * for the lifetime of any resulting error, as normally a string literal does
+ * @param filters filter state associated with current unit instance (which may be null)
+ * @returns the parse error to report if the literal isn't found at the
+ * beginning of *cur*, or unset if it is
+ */
+hilti::rt::Optional<hilti::rt::RecoverableFailure> checkBytesLiteral(
+    hilti::rt::ValueReference<hilti::rt::Stream>& data,
+    const hilti::rt::stream::View& cur,
+    const hilti::rt::Bytes& literal,
+    std::string_view location,
+    const hilti::rt::StrongReference<spicy::rt::filter::detail::Filters>& filters);
+
 } // namespace detail
 } // namespace spicy::rt
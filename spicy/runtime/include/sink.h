@@ -2,8 +2,9 @@
 
 #pragma once
 
-#include <list>
+#include <functional>
 #include <memory>
+#include <set>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -32,6 +33,29 @@ HILTI_EXCEPTION(SinkError, UsageError)
 
 namespace sink {
 enum class ReassemblerPolicy { First };
+
+/**
+ * Determines what a sink does when the amount of out-of-order data it's
+ * buffering exceeds its configured limit.
+ */
+enum class OverflowPolicy {
+    /**
+     * Skips ahead over the leading hole to the first buffered data, as if
+     * `skip()` had been called, until back within the limit.
+     */
+    Skip,
+
+    /** Discards any new out-of-order data that doesn't fit, reporting it as undelivered. */
+    Drop
+};
+
+/** Statistics about a sink's delivery of data to its connected units. */
+struct Statistics {
+    uint64_t num_delivered_bytes = 0; /**< total bytes appended to connected units' input, summed across units */
+    uint64_t num_shared_bytes = 0;    /**< subset of delivered bytes passed on by reference rather than copied */
+    uint64_t max_buffered_bytes = 0;  /**< peak number of data bytes buffered by the reassembler */
+    uint64_t num_overflows = 0;       /**< number of times the buffering limit was exceeded */
+};
 } // namespace sink
 
 namespace sink::detail {
@@ -218,11 +242,34 @@ public:
     /** Sets the sink's reassembler policy. */
     void set_policy(sink::ReassemblerPolicy policy) { _policy = policy; }
 
+    /**
+     * Limits the amount of out-of-order data the reassembler may buffer.
+     * Only data waiting for a leading hole to be filled counts against the
+     * limit; in-order data is always delivered, and data already delivered
+     * but not trimmed yet is not included.
+     *
+     * @param max_bytes maximum number of undelivered data bytes to buffer; zero means unlimited, which is the default
+     * @param policy action to take when new data would exceed the limit
+     */
+    void set_buffer_limit(uint64_t max_bytes, sink::OverflowPolicy policy = sink::OverflowPolicy::Skip) {
+        _max_buffered = max_bytes;
+        _overflow_policy = policy;
+    }
+
+    /** Returns the number of data bytes currently buffered by the reassembler. */
+    uint64_t buffered() const { return _buffered; }
+
+    /** Returns the number of buffered data bytes not delivered yet. */
+    uint64_t pending() const { return _pending; }
+
     /**
      * Returns the number of bytes written into the sink so far.
      */
     hilti::rt::integer::safe<uint64_t> size() const { return _size; }
 
+    /** Returns statistics about the sink's delivery of data so far. */
+    const sink::Statistics& statistics() const { return _statistics; }
+
     /**
      * Skips ahead in the input stream.
      *
@@ -263,9 +310,16 @@ private:
 
         Chunk(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, uint64_t rupper)
             : data(std::move(data)), rseq(rseq), rupper(rupper) {}
+
+        // Buffered chunks never overlap, so ordering them by their starting
+        // sequence numbers orders their ends as well.
+        friend bool operator<(const Chunk& x, const Chunk& y) { return x.rseq < y.rseq; }
+        friend bool operator<(const Chunk& x, uint64_t rseq) { return x.rseq < rseq; }
+        friend bool operator<(uint64_t rseq, const Chunk& x) { return rseq < x.rseq; }
     };
 
-    using ChunkList = std::list<Chunk>;
+    // Ordered by sequence number, with lookups by sequence number.
+    using ChunkList = std::set<Chunk, std::less<>>;
 
     // Returns true if any input has been passed in already (including gaps).
     bool _haveInput() { return _cur_rseq || _chunks.size(); }
@@ -289,11 +343,20 @@ private:
     // (Re-)initialize instance.
     void _init();
 
-    // Add new data to buffer, beginning search for insert position at given start *c*.
-    ChunkList::iterator _addAndCheck(hilti::rt::Optional<hilti::rt::Bytes> data,
+    // Add new data to buffer, resolving any overlap with existing chunks.
+    ChunkList::iterator _addAndCheck(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, uint64_t rupper);
+
+    // Inserts a chunk into the buffer right before the given position, which must be the correct one.
+    ChunkList::iterator _insertChunk(ChunkList::iterator hint,
+                                     hilti::rt::Optional<hilti::rt::Bytes> data,
                                      uint64_t rseq,
-                                     uint64_t rupper,
-                                     ChunkList::iterator c);
+                                     uint64_t rupper);
+
+    // Removes a chunk from the buffer, returning the one following it.
+    ChunkList::iterator _eraseChunk(ChunkList::iterator c);
+
+    // Applies the overflow policy if buffered data exceeds the configured limit.
+    void _checkBufferLimit();
 
     // Deliver data to connected parsers. Returns false if the data is empty (i.e., a gap).
     bool _deliver(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, uint64_t rupper);
@@ -349,6 +412,13 @@ private:
     uint64_t _last_reassem_rseq{}; // Sequence of last byte reassembled and delivered + 1.
     uint64_t _trim_rseq{};         // Sequence of last byte trimmed so far + 1.
     ChunkList _chunks;             // Buffered data not yet delivered or trimmed
+    uint64_t _buffered{};          // Number of data bytes inside `_chunks`.
+    uint64_t _pending{};           // Number of data bytes inside `_chunks` not delivered yet.
+    uint64_t _max_buffered{};      // Limit for `_pending`, or zero for unlimited.
+
+    sink::OverflowPolicy _overflow_policy{}; // Action to take when exceeding `_max_buffered`.
+
+    sink::Statistics _statistics;
 };
 
 } // namespace spicy::rt
@@ -356,4 +426,5 @@ private:
 namespace hilti::rt::detail::adl {
 std::string to_string(const spicy::rt::Sink& /* x */, adl::tag /*unused*/);
 std::string to_string(const spicy::rt::sink::ReassemblerPolicy& x, adl::tag /*unused*/);
+std::string to_string(const spicy::rt::sink::OverflowPolicy& x, adl::tag /*unused*/);
 } // namespace hilti::rt::detail::adl
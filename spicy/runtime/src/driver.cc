@@ -3,14 +3,28 @@
 #include <getopt.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <ios>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include <hilti/rt/autogen/config.h>
+#include <hilti/rt/configuration.h>
+#include <hilti/rt/context.h>
 #include <hilti/rt/exception.h>
 #include <hilti/rt/fmt.h>
+#include <hilti/rt/global-state.h>
 #include <hilti/rt/init.h>
 #include <hilti/rt/profiler.h>
 
@@ -201,7 +215,7 @@ Result<spicy::rt::ParsedUnit> Driver::processInput(const spicy::rt::Parser& pars
             auto profiler = hilti::rt::profiler::start(parser.profiler_tags.prepare_input);
 
             if ( auto n = in.gcount() )
-                data->append(hilti::rt::Bytes(buffer, n));
+                data->append(buffer, static_cast<size_t>(n));
 
             if ( in.peek() == EOF )
                 data->freeze();
@@ -406,15 +420,151 @@ driver::ParsingState::State driver::ParsingState::_process(size_t size, const ch
     hilti::rt::cannot_be_reached();
 }
 
-Result<hilti::rt::Nothing> Driver::processPreBatchedInput(std::istream& in) {
-    std::string magic;
-    std::getline(in, magic);
-
-    if ( magic != std::string("!spicy-batch v2") )
-        return hilti::rt::result::Error("input is not a v2 Spicy batch file");
+// A single command read from a batch.
+struct Driver::BatchCommand {
+    enum class Kind {
+        BeginFlow,
+        BeginConn,
+        Data,
+        Gap,
+        EndFlow,
+        EndConn,
+        Drop, // internal: silently releases the state of flow `id`
+    };
 
+    Kind kind = Kind::BeginFlow;
+    driver::ParsingType type = driver::ParsingType::Stream; // for `@begin-*`
+    hilti::rt::String id;                                     // flow ID, or connection ID for `@*-conn`
+    hilti::rt::String parser;                                 // parser for `@begin-flow`
+    hilti::rt::String orig_id;                                // for `@begin-conn`
+    hilti::rt::String orig_parser;                            // for `@begin-conn`
+    hilti::rt::String resp_id;                                // for `@begin-conn`
+    hilti::rt::String resp_parser;                            // for `@begin-conn`
+    size_t size = 0;                                          // for `@data` and `@gap`
+    std::string data;                                         // for `@data`
+};
+
+// Flows and connections currently active while processing a batch.
+struct Driver::BatchState {
     std::unordered_map<hilti::rt::String, driver::ParsingStateForDriver> flows;
     std::unordered_map<hilti::rt::String, driver::ConnectionState> connections;
+};
+
+// Worker thread processing its share of a batch's flows and connections.
+struct Driver::BatchWorker {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::pair<uint64_t, BatchCommand>> queue; // commands with their sequence numbers; protected by `mutex`
+    bool done = false; // set once no further commands will be queued; protected by `mutex`
+};
+
+Result<bool> Driver::_readBatchCommand(std::istream& in, BatchCommand* cmd) {
+    auto parse_type = [](std::string_view type) -> Result<driver::ParsingType> {
+        if ( type == "stream" )
+            return driver::ParsingType::Stream;
+        else if ( type == "block" )
+            return driver::ParsingType::Block;
+        else
+            return hilti::rt::result::Error(hilti::rt::fmt("unknown session type '%s'", type));
+    };
+
+    while ( in.good() && ! in.eof() ) {
+        std::string line;
+        std::getline(in, line);
+        line = hilti::rt::trim(line);
+
+        if ( line.empty() )
+            continue;
+
+        *cmd = BatchCommand();
+
+        auto m = hilti::rt::split(line);
+        if ( m[0] == "@begin-flow" ) {
+            // @begin-flow <id> <parser> <type>
+            if ( m.size() != 4 )
+                return hilti::rt::result::Error("unexpected number of argument for @begin-flow");
+
+            auto type = parse_type(m[2]);
+            if ( ! type )
+                return type.error();
+
+            cmd->kind = BatchCommand::Kind::BeginFlow;
+            cmd->type = *type;
+            cmd->id = m[1];
+            cmd->parser = m[3];
+        }
+        else if ( m[0] == "@begin-conn" ) {
+            // @begin-conn <conn-id> <type> <orig-id> <orig-parser> <resp-id> <resp-parser>
+            if ( m.size() != 7 )
+                return hilti::rt::result::Error("unexpected number of argument for @begin-conn");
+
+            auto type = parse_type(m[2]);
+            if ( ! type )
+                return type.error();
+
+            cmd->kind = BatchCommand::Kind::BeginConn;
+            cmd->type = *type;
+            cmd->id = m[1];
+            cmd->orig_id = m[3];
+            cmd->orig_parser = m[4];
+            cmd->resp_id = m[5];
+            cmd->resp_parser = m[6];
+        }
+        else if ( m[0] == "@data" ) {
+            // @data <id> <size>
+            // [data]\n
+            if ( m.size() != 3 )
+                return hilti::rt::result::Error("unexpected number of argument for @data");
+
+            cmd->kind = BatchCommand::Kind::Data;
+            cmd->id = m[1];
+            cmd->size = std::stoul(std::string(m[2]));
+            cmd->data = std::string(cmd->size, {});
+
+            in.read(cmd->data.data(), static_cast<std::streamsize>(cmd->size));
+            in.get(); // Eat newline.
+
+            if ( in.eof() || in.fail() )
+                return hilti::rt::result::Error("premature end of @data");
+        }
+        else if ( m[0] == "@gap" ) {
+            // @gap <id> <size>
+            if ( m.size() != 3 )
+                return hilti::rt::result::Error("unexpected number of argument for @gap");
+
+            cmd->kind = BatchCommand::Kind::Gap;
+            cmd->id = m[1];
+            cmd->size = std::stoul(std::string(m[2]));
+        }
+        else if ( m[0] == "@end-flow" ) {
+            // @end-flow <id>
+            if ( m.size() != 2 )
+                return hilti::rt::result::Error("unexpected number of argument for @end-flow");
+
+            cmd->kind = BatchCommand::Kind::EndFlow;
+            cmd->id = m[1];
+        }
+        else if ( m[0] == "@end-conn" ) {
+            // @end-conn <cid>
+            if ( m.size() != 2 )
+                return hilti::rt::result::Error("unexpected number of argument for @end-conn");
+
+            cmd->kind = BatchCommand::Kind::EndConn;
+            cmd->id = m[1];
+        }
+        else
+            return hilti::rt::result::Error(hilti::rt::fmt("unknown command '%s'", m[0]));
+
+        return true;
+    }
+
+    return false;
+}
+
+void Driver::_processBatchCommand(BatchState* state, const BatchCommand& cmd, std::ostream& out) {
+    auto& flows = state->flows;
+    auto& connections = state->connections;
 
     // Helper to add flows to the map.
     auto create_state = [&](driver::ParsingType type,
@@ -440,58 +590,19 @@ Result<hilti::rt::Nothing> Driver::processPreBatchedInput(std::istream& in) {
         }
     };
 
-    while ( in.good() && ! in.eof() ) {
-        std::string cmd;
-        std::getline(in, cmd);
-        cmd = hilti::rt::trim(cmd);
-
-        if ( cmd.empty() )
-            continue;
-
-        auto m = hilti::rt::split(cmd);
-        if ( m[0] == "@begin-flow" ) {
-            // @begin-flow <id> <parser> <type>
-            if ( m.size() != 4 )
-                return hilti::rt::result::Error("unexpected number of argument for @begin-flow");
-
-            auto id = m[1];
-            auto parser_name = m[3];
-
-            driver::ParsingType type;
-
-            if ( m[2] == "stream" )
-                type = driver::ParsingType::Stream;
-            else if ( m[2] == "block" )
-                type = driver::ParsingType::Block;
-            else
-                return hilti::rt::result::Error(hilti::rt::fmt("unknown session type '%s'", m[2]));
-
-            create_state(type, parser_name, id, {}, {});
+    switch ( cmd.kind ) {
+        case BatchCommand::Kind::BeginFlow: {
+            create_state(cmd.type, cmd.parser, cmd.id, {}, {});
+            break;
         }
-        else if ( m[0] == "@begin-conn" ) {
-            // @begin-conn <conn-id> <type> <orig-id> <orig-parser> <resp-id> <resp-parser>
-            if ( m.size() != 7 )
-                return hilti::rt::result::Error("unexpected number of argument for @begin-conn");
-
-            auto cid = m[1];
-            auto orig_id = m[3];
-            auto orig_parser_name = m[4];
-            auto resp_id = m[5];
-            auto resp_parser_name = m[6];
-
-            driver::ParsingType type;
 
-            if ( m[2] == "stream" )
-                type = driver::ParsingType::Stream;
-            else if ( m[2] == "block" )
-                type = driver::ParsingType::Block;
-            else
-                return hilti::rt::result::Error(hilti::rt::fmt("unknown session type '%s'", m[2]));
+        case BatchCommand::Kind::BeginConn: {
+            const auto& cid = cmd.id;
 
             if ( connections.contains(cid) ) {
                 // already exists, ignore
                 DRIVER_DEBUG(hilti::rt::fmt("connection %s exists, skipping", cid));
-                continue;
+                break;
             }
 
             driver::ParsingStateForDriver* orig_state = nullptr;
@@ -499,109 +610,75 @@ Result<hilti::rt::Nothing> Driver::processPreBatchedInput(std::istream& in) {
 
             hilti::rt::Optional<UnitContext> context;
 
-            if ( auto [x, ctx] = create_state(type, orig_parser_name, orig_id, cid, context); x != flows.end() ) {
+            if ( auto [x, ctx] = create_state(cmd.type, cmd.orig_parser, cmd.orig_id, cid, context);
+                 x != flows.end() ) {
                 orig_state = &x->second;
                 context = std::move(ctx);
             }
 
-            if ( auto [x, ctx] = create_state(type, resp_parser_name, resp_id, cid, std::move(context));
+            if ( auto [x, ctx] = create_state(cmd.type, cmd.resp_parser, cmd.resp_id, cid, std::move(context));
                  x != flows.end() )
                 resp_state = &x->second;
 
             if ( ! (orig_state || resp_state) ) {
                 // cannot get parsers, ignore
-                flows.erase(orig_id);
-                flows.erase(resp_id);
-                continue;
+                flows.erase(cmd.orig_id);
+                flows.erase(cmd.resp_id);
+                break;
             }
 
-            connections[cid] = driver::ConnectionState{.orig_id = orig_id,
-                                                       .resp_id = resp_id,
+            connections[cid] = driver::ConnectionState{.orig_id = cmd.orig_id,
+                                                       .resp_id = cmd.resp_id,
                                                        .orig_state = orig_state,
                                                        .resp_state = resp_state};
             _total_connections++;
+            break;
         }
-        else if ( m[0] == "@data" ) {
-            // @data <id> <size>
-            // [data]\n
-            if ( m.size() != 3 )
-                return hilti::rt::result::Error("unexpected number of argument for @data");
-
-            auto id = m[1];
-            auto size = std::stoul(std::string(m[2]));
 
-            std::string data(size, {});
-            in.read(data.data(), static_cast<std::streamsize>(size));
-            in.get(); // Eat newline.
-
-            if ( in.eof() || in.fail() )
-                return hilti::rt::result::Error("premature end of @data");
-
-            auto s = flows.find(id);
+        case BatchCommand::Kind::Data:
+        case BatchCommand::Kind::Gap: {
+            auto s = flows.find(cmd.id);
             if ( s != flows.end() ) {
                 try {
-                    s->second.process(size, data.data());
+                    s->second.process(cmd.size, cmd.kind == BatchCommand::Kind::Data ? cmd.data.data() : nullptr);
                 } catch ( const hilti::rt::Exception& e ) {
-                    std::cout << hilti::rt::fmt("error for ID %s: %s\n", id, e.what());
+                    out << hilti::rt::fmt("error for ID %s: %s\n", cmd.id, e.what());
                 }
             }
-        }
-        else if ( m[0] == "@gap" ) {
-            // @gap <id> <size>
-            if ( m.size() != 3 )
-                return hilti::rt::result::Error("unexpected number of argument for @gap");
 
-            auto id = m[1];
-            auto size = std::stoul(std::string(m[2]));
-
-            auto s = flows.find(id);
-            if ( s != flows.end() ) {
-                try {
-                    s->second.process(size, nullptr);
-                } catch ( const hilti::rt::Exception& e ) {
-                    std::cout << hilti::rt::fmt("error for ID %s: %s\n", id, e.what());
-                }
-            }
+            break;
         }
-        else if ( m[0] == "@end-flow" ) {
-            // @end-flow <id>
-            if ( m.size() != 2 )
-                return hilti::rt::result::Error("unexpected number of argument for @end-flow");
-
-            auto id = m[1];
 
-            auto s = flows.find(id);
+        case BatchCommand::Kind::EndFlow: {
+            auto s = flows.find(cmd.id);
             if ( s != flows.end() ) {
                 try {
                     s->second.finish();
                 } catch ( const hilti::rt::Exception& e ) {
-                    std::cout << hilti::rt::fmt("error for ID %s: %s\n", id, e.what());
+                    out << hilti::rt::fmt("error for ID %s: %s\n", cmd.id, e.what());
                 }
 
                 flows.erase(s);
                 DRIVER_DEBUG_STATS(flows.size(), connections.size());
             }
-        }
-        else if ( m[0] == "@end-conn" ) {
-            // @end-conn <cid>
-            if ( m.size() != 2 )
-                return hilti::rt::result::Error("unexpected number of argument for @end-conn");
 
-            auto cid = m[1];
+            break;
+        }
 
-            if ( auto s = connections.find(cid); s != connections.end() ) {
+        case BatchCommand::Kind::EndConn: {
+            if ( auto s = connections.find(cmd.id); s != connections.end() ) {
                 try {
                     if ( s->second.orig_state )
                         s->second.orig_state->finish();
                 } catch ( const hilti::rt::Exception& e ) {
-                    std::cout << hilti::rt::fmt("error for ID %s: %s\n", s->second.orig_id, e.what());
+                    out << hilti::rt::fmt("error for ID %s: %s\n", s->second.orig_id, e.what());
                 }
 
                 try {
                     if ( s->second.resp_state )
                         s->second.resp_state->finish();
                 } catch ( const hilti::rt::Exception& e ) {
-                    std::cout << hilti::rt::fmt("error for ID %s: %s\n", s->second.resp_id, e.what());
+                    out << hilti::rt::fmt("error for ID %s: %s\n", s->second.resp_id, e.what());
                 }
 
                 flows.erase(s->second.orig_id);
@@ -609,12 +686,288 @@ Result<hilti::rt::Nothing> Driver::processPreBatchedInput(std::istream& in) {
                 connections.erase(s);
                 DRIVER_DEBUG_STATS(flows.size(), connections.size());
             }
+
+            break;
         }
-        else
-            return hilti::rt::result::Error(hilti::rt::fmt("unknown command '%s'", m[0]));
+
+        case BatchCommand::Kind::Drop: {
+            if ( auto s = flows.find(cmd.id); s != flows.end() ) {
+                // A connection may still refer to the flow, make sure it won't access it anymore.
+                for ( auto& [cid, c] : connections ) {
+                    if ( c.orig_state == &s->second )
+                        c.orig_state = nullptr;
+
+                    if ( c.resp_state == &s->second )
+                        c.resp_state = nullptr;
+                }
+
+                flows.erase(s);
+            }
+
+            break;
+        }
+    }
+}
+
+Result<hilti::rt::Nothing> Driver::processPreBatchedInput(std::istream& in, unsigned int threads) {
+    std::string magic;
+    std::getline(in, magic);
+
+    if ( magic != std::string("!spicy-batch v2") )
+        return hilti::rt::result::Error("input is not a v2 Spicy batch file");
+
+    if ( threads > 1 ) {
+#ifdef HILTI_RT_SINGLE_THREADED
+        return hilti::rt::result::Error("runtime was built for single-threaded use, cannot use multiple threads");
+#else
+        return _processPreBatchedInputThreaded(in, threads);
+#endif
+    }
+
+    BatchState state;
+    BatchCommand cmd;
+
+    while ( true ) {
+        auto have_cmd = _readBatchCommand(in, &cmd);
+        if ( ! have_cmd )
+            return have_cmd.error();
+
+        if ( ! *have_cmd )
+            break;
+
+        _processBatchCommand(&state, cmd, std::cout);
     }
 
-    DRIVER_DEBUG_STATS(flows.size(), connections.size());
+    DRIVER_DEBUG_STATS(state.flows.size(), state.connections.size());
 
     return hilti::rt::Nothing();
 }
+
+Result<hilti::rt::Nothing> Driver::_processPreBatchedInputThreaded(std::istream& in, unsigned int threads) {
+    // Globals in static storage would be shared between all workers.
+    for ( const auto& m : hilti::rt::detail::globalState()->hilti_modules ) {
+        if ( m.init_globals && ! m.globals_idx )
+            return hilti::rt::result::Error(
+                fmt("module %s must be compiled with dynamic globals for multi-threaded batch processing", m.name));
+    }
+
+    // Maximum number of commands in flight at any time. This bounds memory
+    // usage for both queued input and output waiting to be written.
+    const uint64_t window = 1024ULL * threads;
+
+    // Output of processed commands, written out in order of their sequence
+    // numbers. Protected by `output_mutex`.
+    std::mutex output_mutex;
+    std::condition_variable output_cv;
+    std::map<uint64_t, std::string> pending_output;
+    uint64_t next_output = 0;
+    std::optional<std::string> error;
+    std::atomic<bool> failed = false;
+
+    auto complete = [&](uint64_t seq, std::string output) {
+        {
+            std::scoped_lock lock(output_mutex);
+            pending_output.emplace(seq, std::move(output));
+
+            for ( auto i = pending_output.begin(); i != pending_output.end() && i->first == next_output;
+                  i = pending_output.erase(i) ) {
+                std::cout << i->second;
+                ++next_output;
+            }
+        }
+
+        output_cv.notify_all();
+    };
+
+    const bool capture_print = hilti::rt::configuration::get().cout.has_value();
+
+    auto run_worker = [&](BatchWorker* worker, hilti::rt::vthread::ID vid) {
+        hilti::rt::Context context(vid);
+        hilti::rt::context::detail::set(&context);
+
+        {
+            BatchState state;
+            std::ostringstream out;
+
+            while ( true ) {
+                std::pair<uint64_t, BatchCommand> next;
+
+                {
+                    std::unique_lock lock(worker->mutex);
+                    worker->cv.wait(lock, [&]() { return worker->done || ! worker->queue.empty(); });
+
+                    if ( worker->queue.empty() )
+                        break;
+
+                    next = std::move(worker->queue.front());
+                    worker->queue.pop_front();
+                }
+
+                context.cout = (capture_print ? &out : nullptr);
+
+                try {
+                    _processBatchCommand(&state, next.second, out);
+                } catch ( const std::exception& e ) {
+                    std::scoped_lock lock(output_mutex);
+                    if ( ! error )
+                        error = fmt("processing failed with exception of type %s: %s",
+                                    hilti::rt::demangle(typeid(e).name()),
+                                    e.what());
+
+                    failed = true;
+                }
+
+                context.cout = nullptr;
+                complete(next.first, out.str());
+                out.str({});
+            }
+
+            DRIVER_DEBUG_STATS(state.flows.size(), state.connections.size());
+        }
+
+        hilti::rt::context::detail::set(nullptr);
+    };
+
+    std::vector<std::unique_ptr<BatchWorker>> workers;
+    for ( unsigned int i = 0; i < threads; i++ )
+        workers.emplace_back(std::make_unique<BatchWorker>());
+
+    for ( unsigned int i = 0; i < threads; i++ )
+        workers[i]->thread = std::thread(run_worker, workers[i].get(), i);
+
+    uint64_t next_seq = 0;
+
+    auto dispatch = [&](unsigned int worker, BatchCommand cmd) {
+        auto seq = next_seq++;
+
+        {
+            std::unique_lock lock(output_mutex);
+            output_cv.wait(lock, [&]() { return seq - next_output < window; });
+        }
+
+        auto& w = *workers[worker];
+
+        {
+            std::scoped_lock lock(w.mutex);
+            w.queue.emplace_back(seq, std::move(cmd));
+        }
+
+        w.cv.notify_one();
+    };
+
+    // Flows and connections are assigned to workers by hashing their IDs,
+    // with a connection's flows following the connection. We track the
+    // assignments of all active flows so that we can route their data.
+    std::unordered_map<hilti::rt::String, unsigned int> routes;
+    std::unordered_map<hilti::rt::String, std::pair<hilti::rt::String, hilti::rt::String>> connection_flows;
+
+    auto worker_for_id = [&](const hilti::rt::String& id) {
+        return static_cast<unsigned int>(std::hash<hilti::rt::String>()(id) % threads);
+    };
+
+    auto route = [&](const hilti::rt::String& id) {
+        if ( auto i = routes.find(id); i != routes.end() )
+            return i->second;
+        else
+            return worker_for_id(id);
+    };
+
+    auto assign = [&](const hilti::rt::String& id, unsigned int worker) {
+        if ( auto i = routes.find(id); i != routes.end() && i->second != worker ) {
+            // The ID is moving to a different worker, which needs to
+            // release the state it still has for it.
+            BatchCommand drop;
+            drop.kind = BatchCommand::Kind::Drop;
+            drop.id = id;
+            dispatch(i->second, std::move(drop));
+        }
+
+        routes[id] = worker;
+    };
+
+    Result<hilti::rt::Nothing> result = hilti::rt::Nothing();
+    BatchCommand cmd;
+
+    while ( ! failed ) {
+        auto have_cmd = _readBatchCommand(in, &cmd);
+        if ( ! have_cmd ) {
+            result = have_cmd.error();
+            break;
+        }
+
+        if ( ! *have_cmd )
+            break;
+
+        switch ( cmd.kind ) {
+            case BatchCommand::Kind::BeginFlow: {
+                // A reused ID stays with the worker that has it already,
+                // which replaces the flow's state like single-threaded
+                // processing does, including for a connection owning it.
+                auto worker = route(cmd.id);
+                assign(cmd.id, worker);
+                dispatch(worker, std::move(cmd));
+                break;
+            }
+
+            case BatchCommand::Kind::BeginConn: {
+                auto worker = worker_for_id(cmd.id);
+
+                if ( ! connection_flows.contains(cmd.id) ) {
+                    assign(cmd.orig_id, worker);
+                    assign(cmd.resp_id, worker);
+                    connection_flows[cmd.id] = std::make_pair(cmd.orig_id, cmd.resp_id);
+                }
+
+                dispatch(worker, std::move(cmd));
+                break;
+            }
+
+            case BatchCommand::Kind::Data:
+            case BatchCommand::Kind::Gap: {
+                dispatch(route(cmd.id), std::move(cmd));
+                break;
+            }
+
+            case BatchCommand::Kind::EndFlow: {
+                auto id = cmd.id;
+                dispatch(route(id), std::move(cmd));
+                routes.erase(id);
+                break;
+            }
+
+            case BatchCommand::Kind::EndConn: {
+                auto cid = cmd.id;
+                dispatch(worker_for_id(cid), std::move(cmd));
+
+                if ( auto i = connection_flows.find(cid); i != connection_flows.end() ) {
+                    routes.erase(i->second.first);
+                    routes.erase(i->second.second);
+                    connection_flows.erase(i);
+                }
+
+                break;
+            }
+
+            case BatchCommand::Kind::Drop: hilti::rt::cannot_be_reached();
+        }
+    }
+
+    for ( auto& w : workers ) {
+        {
+            std::scoped_lock lock(w->mutex);
+            w->done = true;
+        }
+
+        w->cv.notify_one();
+    }
+
+    for ( auto& w : workers )
+        w->thread.join();
+
+    std::cout.flush();
+
+    if ( result && error )
+        return hilti::rt::result::Error(*error);
+
+    return result;
+}
@@ -1,7 +1,10 @@
 // Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
 
+#include <algorithm>
 #include <limits>
+#include <optional>
 #include <sstream>
+#include <string>
 #include <utility>
 
 #include <hilti/rt/exception.h>
@@ -21,6 +24,54 @@ HILTI_EXCEPTION_IMPL(Backtrack)
 HILTI_EXCEPTION_IMPL(MissingData);
 HILTI_EXCEPTION_IMPL(ParseError)
 
+namespace {
+// Codes for parse errors raised by the runtime functions below. Their
+// descriptions get rendered only on demand, from the raw arguments recorded
+// with the error, see `renderParseError()`.
+enum ParseErrorCode : int {
+    InsufficientInput,   // message: caller's error message; values: available
+    InsufficientBytes,   // values: expected, available
+    LiteralInsufficient, // values: expected, available; data: literal
+    LiteralMismatch,     // data: literal, input
+};
+
+std::string renderParseError(const hilti::rt::exception::Deferred& d) {
+    switch ( d.code ) {
+        case InsufficientInput:
+            return hilti::rt::fmt("%s (%" PRIu64 " byte%s available)",
+                                  d.message,
+                                  d.values[0],
+                                  d.values[0] != 1 ? "s" : "");
+
+        case InsufficientBytes:
+            return hilti::rt::fmt("expected %" PRIu64 " bytes (%" PRIu64 " available)", d.values[0], d.values[1]);
+
+        case LiteralInsufficient:
+            return hilti::rt::fmt("expected %" PRIu64 R"( bytes for bytes literal "%s")"
+                                  " (%" PRIu64 " available))",
+                                  d.values[0],
+                                  hilti::rt::Bytes(d.data[0]),
+                                  d.values[1]);
+
+        case LiteralMismatch:
+            return hilti::rt::fmt(R"(expected bytes literal "%s" but input starts with "%s")",
+                                  hilti::rt::Bytes(d.data[0]),
+                                  hilti::rt::Bytes(d.data[1]));
+
+        default: hilti::rt::cannot_be_reached();
+    }
+}
+
+// Returns the raw ingredients of a parse error, rendered on demand by `renderParseError()`.
+hilti::rt::exception::Deferred deferredParseError(ParseErrorCode code, std::string_view location) {
+    hilti::rt::exception::Deferred d;
+    d.render = renderParseError;
+    d.code = code;
+    d.location = location;
+    return d;
+}
+} // namespace
+
 void spicy::rt::Parser::_initProfiling() {
     // Cache profiler tags to avoid recomputing them frequently.
     assert(! name.empty());
@@ -171,9 +222,10 @@ void detail::waitForInputSlow(hilti::rt::ValueReference<hilti::rt::Stream>& data
         if ( ! waitForInputOrEod(data, cur, filters) ) {
             SPICY_RT_DEBUG_VERBOSE(
                 hilti::rt::fmt("insufficient input at end of data for stream %p (which is not ok here)", data.get()));
-            auto msg =
-                hilti::rt::fmt("%s (%" PRIu64 " byte%s available)", error_msg, cur.size(), cur.size() != 1 ? "s" : "");
-            throw ParseError(msg, std::string(location));
+            auto e = deferredParseError(InsufficientInput, location);
+            e.message = error_msg;
+            e.values[0] = cur.size();
+            throw ParseError(std::move(e));
         }
 }
 
@@ -242,9 +294,10 @@ void detail::waitForInput(hilti::rt::ValueReference<hilti::rt::Stream>& data,
     if ( ! waitForInputOrEod(data, cur, filters) ) {
         SPICY_RT_DEBUG_VERBOSE(
             hilti::rt::fmt("insufficient input at end of data for stream %p (which is not ok here)", data.get()));
-        auto msg =
-            hilti::rt::fmt("%s (%" PRIu64 " byte%s available)", error_msg, cur.size(), cur.size() != 1 ? "s" : "");
-        throw ParseError(msg, std::string(location));
+        auto e = deferredParseError(InsufficientInput, location);
+        e.message = error_msg;
+        e.values[0] = cur.size();
+        throw ParseError(std::move(e));
     }
 }
 
@@ -278,6 +331,33 @@ hilti::rt::Optional<hilti::rt::stream::SafeConstIterator> detail::unitFind(
         return {};
 }
 
+hilti::rt::stream::View detail::skipToRegExpCandidate(const hilti::rt::stream::View& cur, const hilti::rt::RegExp& re,
+                                                      uint64_t block_size) {
+    auto limit = std::numeric_limits<uint64_t>::max();
+
+    if ( block_size ) {
+        auto offset = cur.offset();
+        limit = ((offset + block_size - 1) / block_size * block_size) - offset;
+    }
+
+    uint64_t skip = 0;
+
+    try {
+        for ( auto block = cur.firstBlock(); block && skip < limit; block = cur.nextBlock(block) ) {
+            auto len = std::min(block->size, limit - skip);
+            auto n = re.findCandidate(reinterpret_cast<const char*>(block->start), len);
+            skip += n;
+
+            if ( n < len )
+                break;
+        }
+    } catch ( const hilti::rt::MissingData& ) {
+        // Stop in front of the gap, matching will take care of it.
+    }
+
+    return cur.advance(skip);
+}
+
 hilti::rt::Bytes detail::extractBytes(hilti::rt::ValueReference<hilti::rt::Stream>& data,
                                       const hilti::rt::stream::View& cur,
                                       uint64_t size,
@@ -287,30 +367,55 @@ hilti::rt::Bytes detail::extractBytes(hilti::rt::ValueReference<hilti::rt::Strea
     if ( eod_ok )
         detail::waitForInputOrEod(data, cur, size, filters);
     else if ( ! detail::waitForInputNoThrow(data, cur, size, filters) ) {
-        auto msg = hilti::rt::fmt("expected %" PRIu64 " bytes (%" PRIu64 " available)", size, cur.size());
-        throw ParseError(msg, std::string(location));
+        auto e = deferredParseError(InsufficientBytes, location);
+        e.values = {size, cur.size()};
+        throw ParseError(std::move(e));
     }
 
     return cur.sub(cur.begin() + size).data();
 }
 
+// Returns the error to report if *cur* doesn't start with *literal*.
+static std::optional<hilti::rt::exception::Deferred> bytesLiteralMismatch(
+    hilti::rt::ValueReference<hilti::rt::Stream>& data,
+    const hilti::rt::stream::View& cur,
+    const hilti::rt::Bytes& literal,
+    std::string_view location,
+    const hilti::rt::StrongReference<spicy::rt::filter::detail::Filters>& filters) {
+    if ( ! detail::waitForInputNoThrow(data, cur, literal.size(), filters) ) {
+        auto e = deferredParseError(LiteralInsufficient, location);
+        e.values = {literal.size(), cur.size()};
+        e.data[0] = literal.str();
+        return e;
+    }
+
+    if ( ! cur.startsWith(literal) ) {
+        auto e = deferredParseError(LiteralMismatch, location);
+        e.data[0] = literal.str();
+        e.data[1] = cur.sub(cur.begin() + literal.size()).data().str();
+        return e;
+    }
+
+    return {};
+}
+
 void detail::expectBytesLiteral(hilti::rt::ValueReference<hilti::rt::Stream>& data,
                                 const hilti::rt::stream::View& cur,
                                 const hilti::rt::Bytes& literal,
                                 std::string_view location,
                                 const hilti::rt::StrongReference<spicy::rt::filter::detail::Filters>& filters) {
-    if ( ! detail::waitForInputNoThrow(data, cur, literal.size(), filters) ) {
-        auto msg = hilti::rt::fmt("expected %" PRIu64 R"( bytes for bytes literal "%s")"
-                                  " (%" PRIu64 " available))",
-                                  literal.size(),
-                                  literal,
-                                  cur.size());
-        throw ParseError(msg, std::string(location));
-    }
+    if ( auto e = bytesLiteralMismatch(data, cur, literal, location, filters) )
+        throw ParseError(std::move(*e));
+}
 
-    if ( ! cur.startsWith(literal) ) {
-        auto content = cur.sub(cur.begin() + literal.size()).data();
-        throw ParseError(hilti::rt::fmt(R"(expected bytes literal "%s" but input starts with "%s")", literal, content),
-                         location);
-    }
+hilti::rt::Optional<hilti::rt::RecoverableFailure> detail::checkBytesLiteral(
+    hilti::rt::ValueReference<hilti::rt::Stream>& data,
+    const hilti::rt::stream::View& cur,
+    const hilti::rt::Bytes& literal,
+    std::string_view location,
+    const hilti::rt::StrongReference<spicy::rt::filter::detail::Filters>& filters) {
+    if ( auto e = bytesLiteralMismatch(data, cur, literal, location, filters) )
+        return hilti::rt::RecoverableFailure(std::move(*e));
+
+    return {};
 }
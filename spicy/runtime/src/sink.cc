@@ -1,5 +1,7 @@
 // Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
 
+#include <algorithm>
+
 #include <spicy/rt/parser.h>
 #include <spicy/rt/sink.h>
 
@@ -16,87 +18,141 @@ void Sink::_init() {
     _policy = sink::ReassemblerPolicy::First;
     _auto_trim = true;
     _size = 0;
+    _statistics = {};
     _initial_seq = 0;
     _cur_rseq = 0;
     _last_reassem_rseq = 0;
     _trim_rseq = 0;
     _chunks.clear();
+    _buffered = 0;
+    _pending = 0;
+}
+
+Sink::ChunkList::iterator Sink::_insertChunk(ChunkList::iterator hint,
+                                             hilti::rt::Optional<hilti::rt::Bytes> data,
+                                             uint64_t rseq,
+                                             uint64_t rupper) {
+    if ( data ) {
+        _buffered += data->size();
+        _statistics.max_buffered_bytes = std::max(_statistics.max_buffered_bytes, _buffered);
+
+        if ( rseq >= _last_reassem_rseq )
+            _pending += data->size();
+    }
+
+    auto c = _chunks.emplace_hint(hint, std::move(data), rseq, rupper);
+    assert(c->rseq == rseq); // must not have collided with an existing chunk
+    return c;
+}
+
+Sink::ChunkList::iterator Sink::_eraseChunk(ChunkList::iterator c) {
+    if ( c->data ) {
+        _buffered -= c->data->size();
+
+        if ( c->rseq >= _last_reassem_rseq )
+            _pending -= c->data->size();
+    }
+
+    return _chunks.erase(c);
 }
 
 Sink::ChunkList::iterator Sink::_addAndCheck(hilti::rt::Optional<hilti::rt::Bytes> data,
                                              uint64_t rseq,
-                                             uint64_t rupper,
-                                             ChunkList::iterator c) {
+                                             uint64_t rupper) {
     assert(! _chunks.empty());
 
     // Special check for the common case of appending to the end.
-    if ( rseq == _chunks.back().rupper ) {
-        _chunks.emplace_back(std::move(data), rseq, rupper);
-        return std::next(_chunks.end(), -1);
-    }
+    if ( rseq >= _chunks.rbegin()->rupper )
+        return _insertChunk(_chunks.end(), std::move(data), rseq, rupper);
 
     // Find the first block that doesn't come completely before the new data.
-    for ( ; c != _chunks.end() && c->rupper <= rseq; c++ )
-        ;
-
-    if ( c == _chunks.end() ) {
-        // c is the last block, and it comes completely before the new block.
-        _chunks.emplace_back(std::move(data), rseq, rupper);
-        return std::next(_chunks.end(), -1);
-    }
+    // That's either the last one starting at or before the new data, if
+    // that extends into it, or otherwise the first one starting after.
+    auto c = _chunks.upper_bound(rseq);
+    if ( c != _chunks.begin() && std::prev(c)->rupper > rseq )
+        --c;
+
+    // The first chunk we insert for the new data, and the first existing
+    // chunk it overlaps with. We return the former if there's one, and
+    // otherwise the latter.
+    hilti::rt::Optional<ChunkList::iterator> new_c;
+    hilti::rt::Optional<ChunkList::iterator> first_overlap;
+
+    while ( true ) {
+        if ( c == _chunks.end() || rupper <= c->rseq ) {
+            // The new block comes completely before c, or after all existing blocks.
+            auto i = _insertChunk(c, std::move(data), rseq, rupper);
+            return new_c ? *new_c : i;
+        }
 
-    if ( rupper <= c->rseq )
-        // The new block comes completely before c.
-        return _chunks.insert(c, Chunk(std::move(data), rseq, rupper));
+        // The blocks overlap, complain & break up.
 
-    ChunkList::iterator new_c;
+        if ( rseq < c->rseq ) {
+            // The new block has a prefix that comes before c.
+            uint64_t prefix_len = c->rseq - rseq;
 
-    // The blocks overlap, complain & break up.
+            if ( data ) {
+                auto prefix = data->sub(data->begin() + prefix_len);
+                auto i = _insertChunk(c, std::move(prefix), rseq, rseq + prefix_len);
+                data = data->sub(data->begin() + prefix_len, data->end());
 
-    if ( rseq < c->rseq ) {
-        // The new block has a prefix that comes before c.
-        uint64_t prefix_len = c->rseq - rseq;
+                if ( ! new_c )
+                    new_c = i;
+            }
 
-        if ( data ) {
-            auto prefix = data->sub(data->begin() + prefix_len);
-            new_c = _chunks.insert(c, Chunk(std::move(prefix), rseq, rseq + prefix_len));
-            data = data->sub(data->begin() + prefix_len, data->end());
+            rseq += prefix_len;
         }
 
-        rseq += prefix_len;
-    }
+        if ( ! first_overlap )
+            first_overlap = c;
 
-    else
-        new_c = c;
+        auto overlap_start = rseq;
+        auto new_c_len = rupper - rseq;
+        auto c_len = (c->rupper - overlap_start);
+        auto overlap_len = (new_c_len < c_len ? new_c_len : c_len);
 
-    auto overlap_start = rseq;
-    auto new_c_len = rupper - rseq;
-    auto c_len = (c->rupper - overlap_start);
-    auto overlap_len = (new_c_len < c_len ? new_c_len : c_len);
+        hilti::rt::Bytes old_data;
+        hilti::rt::Bytes new_data;
 
-    hilti::rt::Bytes old_data;
-    hilti::rt::Bytes new_data;
+        if ( c->data )
+            old_data = c->data->sub(overlap_start - c->rseq, overlap_start - c->rseq + overlap_len);
 
-    if ( c->data )
-        old_data = c->data->sub(overlap_start - c->rseq, overlap_start - c->rseq + overlap_len);
+        if ( data )
+            new_data = data->sub(overlap_len);
 
-    if ( data )
-        new_data = data->sub(overlap_len);
+        _reportOverlap(overlap_start, old_data, new_data);
 
-    _reportOverlap(overlap_start, old_data, new_data);
+        if ( ! (data && overlap_len < new_c_len) )
+            return new_c ? *new_c : *first_overlap;
 
-    if ( data && overlap_len < new_c_len ) {
-        // Recurse to resolve remainder of the new data.
+        // Continue with the remainder of the new data, which starts right
+        // at the end of c.
         data = data->sub(data->begin() + overlap_len, data->end());
         rseq += overlap_len;
-
-        if ( new_c == c )
-            new_c = _addAndCheck(std::move(data), rseq, rupper, c);
-        else
-            _addAndCheck(std::move(data), rseq, rupper, c);
+        ++c;
     }
+}
+
+void Sink::_checkBufferLimit() {
+    if ( ! _max_buffered || _pending <= _max_buffered )
+        return;
+
+    SPICY_RT_DEBUG_VERBOSE(fmt("sink %p exceeds buffer limit (%" PRIu64 " > %" PRIu64 " bytes), skipping ahead",
+                               this,
+                               _pending,
+                               _max_buffered));
+
+    ++_statistics.num_overflows;
 
-    return new_c;
+    while ( _pending > _max_buffered ) {
+        // Skip over the leading hole, or over a gap blocking delivery. This
+        // delivers whatever becomes contiguous afterwards.
+        auto c = _chunks.lower_bound(_last_reassem_rseq);
+        if ( c == _chunks.end() )
+            break;
+
+        _skip(c->rseq > _last_reassem_rseq ? c->rseq : c->rupper);
+    }
 }
 
 bool Sink::_deliver(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, uint64_t rupper) {
@@ -153,11 +209,23 @@ bool Sink::_deliver(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, u
         states.push_back(std::move(s));
     }
 
+    // With multiple units connected, we turn the data into a single shared
+    // payload that all of them reference, instead of giving each one its own
+    // copy.
+    hilti::rt::stream::SharedDataPtr shared;
+    if ( states.size() > 1 )
+        shared = hilti::rt::make_intrusive<hilti::rt::stream::SharedData>(std::move(*data).str());
+
     for ( auto& s : states ) {
-        if ( states.size() == 1 )
+        if ( shared ) {
+            s->data->append(shared);
+            _statistics.num_shared_bytes += shared->size();
+            _statistics.num_delivered_bytes += shared->size();
+        }
+        else {
+            _statistics.num_delivered_bytes += data->size();
             s->data->append(std::move(*data));
-        else
-            s->data->append(*data);
+        }
 
         try {
             // Sinks are operating independently from the writer, so we
@@ -208,22 +276,38 @@ void Sink::_newData(hilti::rt::Optional<hilti::rt::Bytes> data, uint64_t rseq, u
             data = data->sub(data->begin() + amount_old, data->end());
     }
 
-    if ( _chunks.empty() ) {
-        _chunks.emplace_back(std::move(data), rseq, rseq + len);
-        c = std::next(_chunks.end(), -1);
+    if ( data && rseq > _last_reassem_rseq && _max_buffered && _overflow_policy == sink::OverflowPolicy::Drop &&
+         _pending + data->size() > _max_buffered ) {
+        // No room for more out-of-order data. Data filling the leading
+        // hole always gets through, as it can be delivered right away.
+        SPICY_RT_DEBUG_VERBOSE(fmt("sink %p exceeds buffer limit, dropping data at rseq %" PRIu64, this, rseq));
+        ++_statistics.num_overflows;
+        _reportUndelivered(rseq, *data);
+        goto exit;
     }
+
+    if ( _chunks.empty() )
+        c = _insertChunk(_chunks.end(), std::move(data), rseq, rseq + len);
     else
-        c = _addAndCheck(std::move(data), rseq, rupper_rseq, _chunks.begin());
+        c = _addAndCheck(std::move(data), rseq, rupper_rseq);
 
     // See if we have data in order now to deliver.
 
-    if ( c->rseq > _last_reassem_rseq || c->rupper <= _last_reassem_rseq )
+    if ( c->rseq > _last_reassem_rseq || c->rupper <= _last_reassem_rseq ) {
+        if ( _overflow_policy == sink::OverflowPolicy::Skip )
+            _checkBufferLimit();
+
         goto exit;
+    }
 
     // We've filled a leading hole. Deliver as much as possible.
     _debugReassemblerBuffer("buffer content");
 
     _tryDeliver(c);
+
+    if ( _overflow_policy == sink::OverflowPolicy::Skip )
+        _checkBufferLimit();
+
     return;
 
 exit:
@@ -238,6 +322,23 @@ void Sink::_skip(uint64_t rseq) {
     else
         _reportUndeliveredUpTo(rseq);
 
+    if ( rseq >= _last_reassem_rseq ) {
+        // Anything still buffered before the new position won't be delivered anymore.
+        for ( auto c = _chunks.lower_bound(_last_reassem_rseq); c != _chunks.end() && c->rseq < rseq; ++c ) {
+            if ( c->data )
+                _pending -= c->data->size();
+        }
+    }
+    else {
+        // Moving backwards, anything buffered from the new position on is pending again.
+        _pending = 0;
+
+        for ( auto c = _chunks.lower_bound(rseq); c != _chunks.end(); ++c ) {
+            if ( c->data )
+                _pending += c->data->size();
+        }
+    }
+
     _cur_rseq = rseq;
     _last_reassem_rseq = rseq;
 
@@ -253,7 +354,7 @@ void Sink::_trim(uint64_t rseq) {
         SPICY_RT_DEBUG_VERBOSE(fmt("trimming sink %p to EOD", this));
     }
 
-    for ( auto c = _chunks.begin(); c != _chunks.end(); c = _chunks.erase(c) ) {
+    for ( auto c = _chunks.begin(); c != _chunks.end(); c = _eraseChunk(c) ) {
         if ( c->rseq >= rseq )
             break;
 
@@ -273,6 +374,9 @@ void Sink::_tryDeliver(ChunkList::iterator c) {
     for ( ; c != _chunks.end(); c++ ) {
         if ( c->rseq == _last_reassem_rseq ) {
             // New stuff.
+            if ( c->data )
+                _pending -= c->data->size();
+
             _last_reassem_rseq += (c->rupper - c->rseq);
             if ( ! _deliver(c->data, c->rseq, c->rupper) ) {
                 // Hit gap.
@@ -498,4 +602,13 @@ std::string to_string(const sink::ReassemblerPolicy& x, tag /*unused*/) {
 
     cannot_be_reached();
 }
+
+std::string to_string(const sink::OverflowPolicy& x, tag /*unused*/) {
+    switch ( x ) {
+        case spicy::rt::sink::OverflowPolicy::Skip: return "sink::OverflowPolicy::Skip";
+        case spicy::rt::sink::OverflowPolicy::Drop: return "sink::OverflowPolicy::Drop";
+    }
+
+    cannot_be_reached();
+}
 } // namespace hilti::rt::detail::adl
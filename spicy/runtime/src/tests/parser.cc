@@ -12,6 +12,7 @@
 #include <hilti/rt/init.h>
 #include <hilti/rt/test/utils.h>
 #include <hilti/rt/types/reference.h>
+#include <hilti/rt/types/regexp.h>
 #include <hilti/rt/types/stream.h>
 #include <hilti/rt/types/vector.h>
 
@@ -504,6 +505,23 @@ TEST_CASE("expectBytesLiteral") {
                          const spicy::rt::ParseError&);
 }
 
+TEST_CASE("checkBytesLiteral") {
+    auto data = hilti::rt::ValueReference<hilti::rt::Stream>();
+    data->append("12345");
+    data->freeze();
+
+    CHECK(! detail::checkBytesLiteral(data, data->view(), "123"_b, "<location>", {}));
+
+    auto mismatch = detail::checkBytesLiteral(data, data->view(), "abc"_b, "<location>", {});
+    REQUIRE(mismatch);
+    CHECK_EQ(std::string(mismatch->what()),
+             "expected bytes literal \"abc\" but input starts with \"123\" (<location>)");
+
+    auto eod = detail::checkBytesLiteral(data, data->view(), "1234567"_b, "<location>", {});
+    REQUIRE(eod);
+    CHECK_EQ(std::string(eod->location()), "<location>");
+}
+
 TEST_CASE("unitFind") {
     // We just tests the argument forwarding here, the matching itself is
     // covered by hilti::rt::stream::View::find().
@@ -519,4 +537,62 @@ TEST_CASE("unitFind") {
     CHECK(! detail::unitFind(begin, end, s.at(4), "XYZ"_b, hilti::rt::stream::Direction::Backward));
 }
 
+TEST_CASE("findLiteral") {
+    // We just tests the argument forwarding here, the matching itself is
+    // covered by hilti::rt::stream::View::find().
+
+    auto s = hilti::rt::Stream("0123456789012");
+    const auto searcher = detail::createSearcher("901"_b);
+
+    auto x = detail::findLiteral(s.view(), searcher);
+    CHECK(hilti::rt::tuple::get<0>(x));
+    CHECK_EQ(hilti::rt::tuple::get<1>(x), s.at(9));
+
+    x = detail::findLiteral(s.view().advance(10), searcher);
+    CHECK(! hilti::rt::tuple::get<0>(x));
+    CHECK_EQ(hilti::rt::tuple::get<1>(x), s.at(13));
+}
+
+TEST_CASE("skipToRegExpCandidate") {
+    const auto re = hilti::rt::RegExp(hilti::rt::regexp::Pattern("XY[0-9]"));
+
+    SUBCASE("candidate") {
+        auto s = hilti::rt::Stream("0123XY5678");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 0).begin(), s.at(4));
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view().advance(4), re, 0).begin(), s.at(4));
+    }
+
+    SUBCASE("none") {
+        auto s = hilti::rt::Stream("0123456789");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 0).begin(), s.at(10));
+    }
+
+    SUBCASE("partial at end") {
+        auto s = hilti::rt::Stream("01234567X");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 0).begin(), s.at(8));
+    }
+
+    SUBCASE("across chunks") {
+        auto s = hilti::rt::Stream("0123");
+        s.append("45");
+        s.append("6XY7");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 0).begin(), s.at(7));
+    }
+
+    SUBCASE("block boundary") {
+        auto s = hilti::rt::Stream("0123456789XY0");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 4).begin(), s.at(0));
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view().advance(1), re, 4).begin(), s.at(4));
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view().advance(5), re, 4).begin(), s.at(8));
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view().advance(9), re, 4).begin(), s.at(10));
+    }
+
+    SUBCASE("gap") {
+        auto s = hilti::rt::Stream("0123");
+        s.append(nullptr, 3);
+        s.append("XY7");
+        CHECK_EQ(detail::skipToRegExpCandidate(s.view(), re, 0).begin(), s.at(4));
+    }
+}
+
 TEST_SUITE_END();
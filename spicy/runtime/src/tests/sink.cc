@@ -3,14 +3,111 @@
 #include <doctest/doctest.h>
 
 #include <hilti/rt/extension-points.h>
+#include <hilti/rt/init.h>
 
 #include <spicy/rt/sink.h>
 
 using namespace hilti::rt;
+using namespace hilti::rt::bytes::literals;
 using namespace spicy::rt;
 
 TEST_SUITE_BEGIN("Sink");
 
-TEST_CASE("to_string") { CHECK_EQ(to_string(sink::ReassemblerPolicy::First), "sink::ReassemblerPolicy::First"); }
+TEST_CASE("to_string") {
+    CHECK_EQ(to_string(sink::ReassemblerPolicy::First), "sink::ReassemblerPolicy::First");
+    CHECK_EQ(to_string(sink::OverflowPolicy::Skip), "sink::OverflowPolicy::Skip");
+    CHECK_EQ(to_string(sink::OverflowPolicy::Drop), "sink::OverflowPolicy::Drop");
+}
+
+TEST_CASE("reassembly") {
+    hilti::rt::init(); // Noop if already initialized.
+
+    Sink sink;
+
+    SUBCASE("out of order") {
+        sink.write("789"_b, 6);
+        sink.write("456"_b, 3);
+        CHECK_EQ(sink.buffered(), 6);
+        CHECK_EQ(sink.size(), 0);
+
+        sink.write("123"_b, 0);
+        CHECK_EQ(sink.buffered(), 0);
+        CHECK_EQ(sink.size(), 9);
+        CHECK_EQ(sink.sequence_number(), 9);
+        CHECK_EQ(sink.statistics().max_buffered_bytes, 9); // includes the final chunk before delivery
+    }
+
+    SUBCASE("overlaps") {
+        sink.write("56"_b, 4);
+        sink.write("ABCDEFGH"_b, 2); // overlaps "56" on both sides; first data wins
+        CHECK_EQ(sink.buffered(), 8);
+
+        sink.write("12"_b, 0);
+        CHECK_EQ(sink.buffered(), 0);
+        CHECK_EQ(sink.size(), 10);
+    }
+
+    SUBCASE("overlap spanning multiple chunks") {
+        sink.write("3"_b, 3);
+        sink.write("6"_b, 6);
+        sink.write("9"_b, 9);
+        sink.write("ABCDEFGHI"_b, 2);
+        CHECK_EQ(sink.buffered(), 9);
+
+        sink.write("12"_b, 0);
+        CHECK_EQ(sink.size(), 11);
+        CHECK_EQ(sink.buffered(), 0);
+    }
+
+    SUBCASE("buffer limit with skip") {
+        sink.set_buffer_limit(5, sink::OverflowPolicy::Skip);
+        sink.write("AB"_b, 10);
+        sink.write("CD"_b, 20);
+        CHECK_EQ(sink.buffered(), 4);
+        CHECK_EQ(sink.statistics().num_overflows, 0);
+
+        sink.write("EF"_b, 30);
+        CHECK_EQ(sink.statistics().num_overflows, 1);
+        CHECK_LE(sink.buffered(), 5);
+        CHECK_EQ(sink.sequence_number(), 12);
+        CHECK_EQ(sink.size(), 2);
+    }
+
+    SUBCASE("buffer limit with drop") {
+        sink.set_buffer_limit(5, sink::OverflowPolicy::Drop);
+        sink.write("AB"_b, 10);
+        sink.write("CD"_b, 20);
+        sink.write("EF"_b, 30);
+        CHECK_EQ(sink.statistics().num_overflows, 1);
+        CHECK_EQ(sink.buffered(), 4);
+        CHECK_EQ(sink.sequence_number(), 0);
+    }
+
+    SUBCASE("buffer limit lets data filling the hole through") {
+        sink.set_buffer_limit(4, sink::OverflowPolicy::Drop);
+        sink.write("23"_b, 2);
+        sink.write("45"_b, 4);
+        CHECK_EQ(sink.pending(), 4);
+
+        sink.write("01"_b, 0);
+        CHECK_EQ(sink.statistics().num_overflows, 0);
+        CHECK_EQ(sink.sequence_number(), 6);
+        CHECK_EQ(sink.pending(), 0);
+        CHECK_EQ(sink.buffered(), 0);
+    }
+
+    SUBCASE("buffer limit ignores delivered data") {
+        sink.set_auto_trim(false);
+        sink.set_buffer_limit(4, sink::OverflowPolicy::Skip);
+        sink.write("0123"_b, 0);
+        sink.write("AB"_b, 10);
+        CHECK_EQ(sink.statistics().num_overflows, 0);
+        CHECK_EQ(sink.buffered(), 6);
+        CHECK_EQ(sink.pending(), 2);
+        CHECK_EQ(sink.sequence_number(), 4);
+    }
+
+    sink.close();
+}
 
 TEST_SUITE_END();
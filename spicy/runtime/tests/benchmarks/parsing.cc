@@ -9,6 +9,7 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <hilti/rt/configuration.h>
 #include <hilti/rt/init.h>
 #include <hilti/rt/logging.h>
 #include <hilti/rt/types/reference.h>
@@ -62,12 +63,36 @@ static std::string makeBytesInput(std::uint64_t entry_count) {
     return bigEndian(entries.size()) + entries;
 }
 
+static std::string makeHeadersInput(std::uint64_t entry_count) {
+    // Each Header: 1 + 1 + 2 + 4 + 4 + 4 + 2 + 2 + 8 = 28 bytes
+    std::string entries(entry_count * 28, '\x01');
+    return bigEndian(entries.size()) + entries;
+}
+
+static std::string makeSyncInput(std::uint64_t input_size) {
+    // Fails on the first byte, then needs to skip over the garbage to resynchronize.
+    return hilti::rt::fmt("x%sMAGIC42;END", std::string(input_size, 'B'));
+}
+
+static std::string makeRecoveryInput(std::uint64_t record_count) {
+    // Fails on the first byte, then fails again on every record but the last.
+    std::string records;
+    for ( std::uint64_t i = 0; i < record_count; ++i )
+        records += std::string("MAGIC\x00", 6);
+
+    return "x" + records + "MAGIC\x01" + "END";
+}
+
 template<class... Args>
-static void benchmarkParser(benchmark::State& state, Args&&... args) {
+static void runParser(benchmark::State& state, bool direct_execution, Args&&... args) {
     auto args_tuple = std::make_tuple(std::move(args)...);
     const auto& parser_name = std::get<0>(args_tuple);
     auto make_input = std::get<1>(args_tuple);
 
+    auto config = hilti::rt::configuration::get();
+    config.fiber_direct_execution = direct_execution;
+    hilti::rt::configuration::set(std::move(config));
+
     hilti::rt::init();
     spicy::rt::init();
 
@@ -95,6 +120,18 @@ static void benchmarkParser(benchmark::State& state, Args&&... args) {
     hilti::rt::done();
 }
 
+// Input is frozen, so this parses directly on the caller's stack.
+template<class... Args>
+static void benchmarkParser(benchmark::State& state, Args&&... args) {
+    runParser(state, true, std::forward<Args>(args)...);
+}
+
+// Same, but forces parsing to go through a fiber as it would for incremental input.
+template<class... Args>
+static void benchmarkParserWithFiber(benchmark::State& state, Args&&... args) {
+    runParser(state, false, std::forward<Args>(args)...);
+}
+
 static const int64_t min_input = 100;
 static const int64_t max_input = 100000;
 static const int64_t mult = 10;
@@ -123,4 +160,28 @@ BENCHMARK_CAPTURE(benchmarkParser, Benchmark::UnitBytes, "Benchmark::UnitBytes"_
     ->RangeMultiplier(mult)
     ->Range(min_input, max_input);
 
+BENCHMARK_CAPTURE(benchmarkParser, Benchmark::UnitHeaders, "Benchmark::UnitHeaders"_hs, makeHeadersInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
+BENCHMARK_CAPTURE(benchmarkParser, Benchmark::RegexSync, "Benchmark::RegexSync"_hs, makeSyncInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
+BENCHMARK_CAPTURE(benchmarkParser, Benchmark::RecoverySync, "Benchmark::RecoverySync"_hs, makeRecoveryInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
+BENCHMARK_CAPTURE(benchmarkParserWithFiber, Benchmark::UnitVectorSize, "Benchmark::UnitVectorSize"_hs, makeInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
+BENCHMARK_CAPTURE(benchmarkParserWithFiber, Benchmark::UnitNested, "Benchmark::UnitNested"_hs, makeNestedInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
+BENCHMARK_CAPTURE(benchmarkParserWithFiber, Benchmark::UnitHeaders, "Benchmark::UnitHeaders"_hs, makeHeadersInput)
+    ->RangeMultiplier(mult)
+    ->Range(min_input, max_input);
+
 BENCHMARK_MAIN();
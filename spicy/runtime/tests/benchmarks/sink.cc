@@ -0,0 +1,71 @@
+// Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+#include <benchmark/benchmark.h>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <hilti/rt/init.h>
+#include <hilti/rt/types/bytes.h>
+
+#include <spicy/rt/init.h>
+#include <spicy/rt/sink.h>
+
+// Splits input of the given size into fixed-size segments, returned as pairs
+// of sequence number and payload. With `reorder` set, the segments are
+// shuffled except for the first one, so that the sink needs to buffer almost
+// all of them before it can deliver anything.
+static std::vector<std::pair<uint64_t, hilti::rt::Bytes>> makeSegments(int64_t num_segments, bool reorder) {
+    const uint64_t segment_size = 100;
+
+    std::vector<std::pair<uint64_t, hilti::rt::Bytes>> segments;
+    segments.reserve(static_cast<size_t>(num_segments));
+
+    for ( int64_t i = 0; i < num_segments; i++ )
+        segments.emplace_back(static_cast<uint64_t>(i) * segment_size, hilti::rt::Bytes(std::string(segment_size, 'x')));
+
+    if ( reorder ) {
+        std::mt19937 rng(42); // NOLINT(cert-msc32-c,cert-msc51-cpp) deterministic on purpose
+        std::shuffle(segments.begin() + 1, segments.end(), rng);
+        std::swap(segments.front(), segments.back()); // sequence number zero comes last
+    }
+
+    return segments;
+}
+
+static void benchmarkSinkReassembly(benchmark::State& state, bool reorder) {
+    hilti::rt::init();
+    spicy::rt::init();
+
+    for ( auto _ : state ) {
+        (void)_;
+        state.PauseTiming();
+        auto segments = makeSegments(state.range(0), reorder);
+        spicy::rt::Sink sink;
+        state.ResumeTiming();
+
+        for ( auto& [seq, data] : segments )
+            sink.write(std::move(data), seq);
+
+        benchmark::DoNotOptimize(sink.size());
+    }
+
+    hilti::rt::done();
+}
+
+static const int64_t min_segments = 100;
+static const int64_t max_segments = 100000;
+static const int64_t mult = 10;
+
+BENCHMARK_CAPTURE(benchmarkSinkReassembly, InOrder, false)->RangeMultiplier(mult)->Range(min_segments, max_segments);
+BENCHMARK_CAPTURE(benchmarkSinkReassembly, Reordered, true)->RangeMultiplier(mult)->Range(min_segments, max_segments);
@@ -2,6 +2,7 @@
 
 #include <getopt.h>
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <ranges>
@@ -42,6 +43,7 @@ static struct option long_driver_options[] = {
     {.name = "skip-dependencies", .has_arg = no_argument, .flag = nullptr, .val = 'S'},
     {.name = "report-resource-usage", .has_arg = no_argument, .flag = nullptr, .val = 'U'},
     {.name = "skip-validation", .has_arg = no_argument, .flag = nullptr, .val = 'V'},
+    {.name = "threads", .has_arg = required_argument, .flag = nullptr, .val = 'T'},
     {.name = "strict-public-api", .has_arg = no_argument, .flag = nullptr, .val = OptStrictPublicAPI},
     {.name = "no-strict-public-api", .has_arg = no_argument, .flag = nullptr, .val = OptNoStrictPublicAPI},
     {.name = "version", .has_arg = no_argument, .flag = nullptr, .val = 'v'},
@@ -50,10 +52,10 @@ static struct option long_driver_options[] = {
 
 static bool require_accept = false; // --require-accept
 
-static bool accepted = false; // set by hook_accept_input()
+static std::atomic<bool> accepted = false; // set by hook_accept_input()
 static void hookAcceptInput() { accepted = true; }
 
-static bool declined = false; // set by hook_decline_input()
+static std::atomic<bool> declined = false; // set by hook_decline_input()
 static void hookDeclineInput(const std::string& /*reason*/) { declined = true; }
 
 namespace {
@@ -69,6 +71,7 @@ public:
 
     int opt_list_parsers = 0;
     int opt_increment = 0;
+    unsigned int opt_threads = 1;
     bool opt_input_is_batch = false;
     std::string opt_file = "/dev/stdin";
     std::string opt_parser;
@@ -113,6 +116,7 @@ void SpicyDriver::usage() {
            "  -P | --parser-alias <alias>=<name>  Add alias name for parser of existing name.\n"
            "  -R | --report-times                 Report a break-down of compiler's execution time.\n"
            "  -S | --skip-dependencies            Do not automatically compile dependencies during JIT.\n"
+           "  -T | --threads <n>                  Process batch input with <n> worker threads.\n"
            "  -U | --report-resource-usage        Print summary of runtime resource usage.\n"
            "  -V | --skip-validation              Don't validate ASTs (for debugging only).\n"
            "  -X | --debug-addl <addl>            Implies -d and adds selected additional instrumentation "
@@ -146,7 +150,7 @@ void SpicyDriver::parseOptions(int argc, char** argv) {
     driver_options.logger = std::make_unique<hilti::Logger>();
 
     while ( true ) {
-        int c = getopt_long(argc, argv, "ABcD:f:F:ghdJX:Vlp:P:i:SRL:UVZ", long_driver_options, nullptr);
+        int c = getopt_long(argc, argv, "ABcD:f:F:ghdJX:Vlp:P:i:SRL:T:UVZ", long_driver_options, nullptr);
 
         if ( c < 0 )
             break;
@@ -242,6 +246,15 @@ void SpicyDriver::parseOptions(int argc, char** argv) {
 
             case 'S': driver_options.skip_dependencies = true; break;
 
+            case 'T': {
+                auto n = atoi(optarg); // NOLINT
+                if ( n < 1 )
+                    fatalError("number of threads must be at least 1");
+
+                opt_threads = static_cast<unsigned int>(n);
+                break;
+            }
+
             case 'U': driver_options.report_resource_usage = true; break;
 
             case 'v': std::cout << "spicy-driver v" << hilti::configuration().version_string_long << '\n'; exit(0);
@@ -271,6 +284,10 @@ void SpicyDriver::parseOptions(int argc, char** argv) {
         }
     }
 
+    if ( opt_threads > 1 )
+        // Give each worker thread its own set of globals.
+        compiler_options.cxx_enable_dynamic_globals = true;
+
     setCompilerOptions(std::move(compiler_options));
     setDriverOptions(std::move(driver_options));
 
@@ -340,7 +357,7 @@ int main(int argc, char** argv) try {
 #endif
 
         if ( driver.opt_input_is_batch ) {
-            if ( auto x = driver.processPreBatchedInput(in); ! x )
+            if ( auto x = driver.processPreBatchedInput(in, driver.opt_threads); ! x )
                 driver.fatalError(x.error());
         }
         else {
@@ -60,6 +60,7 @@ class ConnectFilter;
 class Gap;
 class SequenceNumber;
 class SetAutoTrim;
+class SetBufferLimit;
 class SetInitialSequenceNumber;
 class SetPolicy;
 class Skip;
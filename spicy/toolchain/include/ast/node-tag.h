@@ -30,6 +30,7 @@ constexpr unsigned int SequenceNumber = 10307;
 constexpr unsigned int SetAutoTrim = 10308;
 constexpr unsigned int SetInitialSequenceNumber = 10309;
 constexpr unsigned int SetPolicy = 10310;
+constexpr unsigned int SetBufferLimit = 10311;
 constexpr unsigned int Size = 10312;
 constexpr unsigned int Skip = 10313;
 constexpr unsigned int Trim = 10314;
@@ -21,6 +21,7 @@ SPICY_NODE_OPERATOR(sink, ConnectFilter)
 SPICY_NODE_OPERATOR(sink, Gap)
 SPICY_NODE_OPERATOR(sink, SequenceNumber)
 SPICY_NODE_OPERATOR(sink, SetAutoTrim)
+SPICY_NODE_OPERATOR(sink, SetBufferLimit)
 SPICY_NODE_OPERATOR(sink, SetInitialSequenceNumber)
 SPICY_NODE_OPERATOR(sink, SetPolicy)
 SPICY_NODE_OPERATOR(sink, Skip)
@@ -27,6 +27,7 @@ public:
     virtual void operator()(spicy::operator_::sink::Gap*) {}
     virtual void operator()(spicy::operator_::sink::SequenceNumber*) {}
     virtual void operator()(spicy::operator_::sink::SetAutoTrim*) {}
+    virtual void operator()(spicy::operator_::sink::SetBufferLimit*) {}
     virtual void operator()(spicy::operator_::sink::SetInitialSequenceNumber*) {}
     virtual void operator()(spicy::operator_::sink::SetPolicy*) {}
     virtual void operator()(spicy::operator_::sink::Skip*) {}
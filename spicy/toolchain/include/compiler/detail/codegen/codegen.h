@@ -115,6 +115,18 @@ public:
      */
     Expression* addGlobalConstant(Ctor* ctor);
 
+    /**
+     * Adds a global precompiled searcher for a constant bytes value to the
+     * current module and returns an expression referring to it. The searcher
+     * is a constant computed once per process. If this is called multiple
+     * times for the same value, only one instance is created and returned
+     * each time.
+     *
+     * @param ctor the value to search for
+     * @return an expression referring to the searcher, of type `spicy_rt::Searcher`
+     */
+    Expression* addGlobalSearcher(hilti::ctor::Bytes* ctor);
+
 private:
     bool _compileModule(hilti::declaration::Module* module, int pass, codegen::ASTInfo* info);
     void _updateDeclarations(visitor::MutatingPostOrder* v, hilti::declaration::Module* module);
@@ -179,6 +179,13 @@ struct ParserState {
      * Expression* holding the last parse error if any. This field is set only in sync or trial mode.
      */
     Expression* error = nullptr;
+
+    /**
+     * True if generated code has already ensured that enough input is
+     * available for all fixed-size values parsed in the current context,
+     * so that parsing them doesn't need to wait for input individually.
+     */
+    bool input_prefetched = false;
 };
 
 /** Generates the parsing logic for a unit type. */
@@ -279,6 +286,26 @@ public:
     /** Returns an object whose destructor pops the most recent statement builder. */
     ScopeGuard makeScopeGuard() { return ScopeGuard(this); }
 
+    /**
+     * Marks a block as a recovery scope for subsequently generated code.
+     * Parse errors raised directly inside the block, rather than from a
+     * called function or from inside a nested loop, switch, or `try`, will
+     * then be recorded in a variable and leave the block through `break`,
+     * instead of throwing an exception. The caller must place the block
+     * directly inside a loop so that the `break` leaves it, and must check
+     * the variable after that loop to handle any failure recorded there.
+     *
+     * @param block block to turn into a recovery scope
+     * @param failure variable of type `optional<hilti::RecoverableFailure>`
+     * receiving the failure
+     */
+    void pushRecoveryScope(hilti::statement::Block* block, Expression* failure) {
+        _recovery_scopes.push_back({block, failure});
+    }
+
+    /** Removes the most recent recovery scope. */
+    void popRecoveryScope() { _recovery_scopes.pop_back(); }
+
     /** Activates a statement builder for subsequent code. */
     template<typename Func>
     auto pushBuilder(std::shared_ptr<Builder> b, Func&& func) {
@@ -356,6 +383,17 @@ public:
      */
     void waitForInput(Expression* min, std::string_view error_msg, const Meta& location);
 
+    /**
+     * Generates code that confirms that the input begins with a given bytes
+     * literal, waiting for enough data to become available first. It will
+     * abort parsing if it finds something else, or if end-of-data is reached
+     * before that.
+     *
+     * @param literal bytes expression with the literal to expect
+     * @param location location associated with the operation.
+     */
+    void expectBytesLiteral(Expression* literal, const Meta& location);
+
     /**
      * Generates code that ensures that either a minimum amount of data is
      * available for parsing, or end-of-data is reached. The generated code
@@ -409,8 +447,12 @@ public:
     /**
      * Generates code that advances the current view to the next position which is not a gap.
      * This implicitly calls advancedInput() afterwards.
+     *
+     * @param prefilter if given, a regular expression; the view then further
+     * skips ahead to where a match of it may start, so that searching doesn't
+     * need to try every single position
      */
-    void advanceToNextData();
+    void advanceToNextData(Expression* prefilter = nullptr);
 
     /**
      * Generates code that advances the current view to a new start position.
@@ -450,13 +492,25 @@ public:
      */
     void consumeLookAhead(Expression* dst = nullptr);
 
-    /** Generates code that triggers a parse error exception. */
+    /**
+     * Generates code that triggers a parse error. Inside a recovery scope,
+     * that records the error and leaves the scope; otherwise it throws a
+     * parse error exception.
+     */
     void parseError(std::string_view error_msg, const Meta& meta = {});
 
-    /** Generates code that triggers a parse error exception. */
+    /**
+     * Generates code that triggers a parse error. Inside a recovery scope,
+     * that records the error and leaves the scope; otherwise it throws a
+     * parse error exception.
+     */
     void parseError(Expression* error_msg, const Meta& meta = {});
 
-    /** Generates code that triggers a parse error exception. */
+    /**
+     * Generates code that triggers a parse error. Inside a recovery scope,
+     * that records the error and leaves the scope; otherwise it throws a
+     * parse error exception.
+     */
     void parseError(std::string_view fmt, const Expressions& args, const Meta& meta = {});
 
     /** Generates code that triggers a parse error exception. */
@@ -589,6 +643,17 @@ public:
     QualifiedType* lookAheadType() const;
     hilti::Expression* featureConstant(const type::Unit* unit, std::string_view feature);
 
+    /**
+     * Returns an expression searching the current input for a delimiter, as
+     * needed for `&until` and friends. The expression evaluates to a tuple
+     * `(found, it)` with the semantics of `stream::View::find()`. If the
+     * delimiter is a constant, the search uses a precompiled global searcher.
+     *
+     * @param delimiter the original delimiter expression
+     * @param value expression holding the delimiter's value coerced to bytes
+     */
+    Expression* findDelimiter(Expression* delimiter, Expression* value);
+
     /** Adds a temporary to store an attribute's expression, if necessary. */
     Expression* evaluateAttributeExpression(const hilti::Attribute* attr, const std::string& prefix);
 
@@ -619,9 +684,20 @@ private:
 
     std::shared_ptr<Builder> _featureCodeIf(const type::Unit* unit, const std::vector<std::string_view>& features);
 
+    // Returns the failure variable of the current recovery scope if the
+    // current builder's block is directly inside that scope, or null if not.
+    Expression* _recoveryFailure() const;
+
     CodeGen* _cg;
     std::vector<ParserState> _states;
     std::vector<std::shared_ptr<Builder>> _builders;
+
+    struct RecoveryScope {
+        hilti::statement::Block* block = nullptr;
+        Expression* failure = nullptr;
+    };
+
+    std::vector<RecoveryScope> _recovery_scopes;
     std::map<ID, Expression*> _functions;
     bool _report_new_value_for_field = true;
 };
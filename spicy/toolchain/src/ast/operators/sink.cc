@@ -264,6 +264,43 @@ more information about trimming.
 };
 HILTI_OPERATOR_IMPLEMENTATION(SetAutoTrim);
 
+class SetBufferLimit : public hilti::BuiltInMemberCall {
+public:
+    Signature signature(hilti::Builder* builder_) const final {
+        auto builder = Builder(builder_);
+        return Signature{
+            .kind = Kind::MemberCall,
+            .self = {.kind = hilti::parameter::Kind::InOut, .type = builder.typeSink()},
+            .member = "set_buffer_limit",
+            .param0 =
+                {
+                    .name = "max_bytes",
+                    .type = {.kind = hilti::parameter::Kind::In, .type = builder.typeUnsignedInteger(64)},
+                },
+            .param1 =
+                {
+                    .name = "policy",
+                    .type = {.kind = hilti::parameter::Kind::In, .type = builder.typeName("spicy::OverflowPolicy")},
+                    .optional = true,
+                },
+            .result = {.constness = hilti::Constness::Const, .type = builder.typeVoid()},
+            .ns = "sink",
+            .doc = R"(
+Limits the amount of out-of-order data the sink buffers while waiting for a
+leading hole to be filled. In-order data is always delivered right away and
+doesn't count against the limit. Once the limit is exceeded, ``policy``
+decides what happens: ``OverflowPolicy::Skip`` (the default) skips ahead over
+the hole as if ``skip()`` had been called; ``OverflowPolicy::Drop`` discards
+the new out-of-order data instead. A limit of zero, which is the default,
+means unlimited.
+)",
+        };
+    }
+
+    HILTI_OPERATOR(spicy, sink::SetBufferLimit);
+};
+HILTI_OPERATOR_IMPLEMENTATION(SetBufferLimit);
+
 class SetInitialSequenceNumber : public hilti::BuiltInMemberCall {
 public:
     Signature signature(hilti::Builder* builder_) const final {
@@ -1,6 +1,7 @@
 // Copyright (c) 2020-now by the Zeek Project. See LICENSE for details.
 
 #include <hilti/ast/builder/builder.h>
+#include <hilti/ast/ctors/bytes.h>
 #include <hilti/ast/ctors/coerced.h>
 #include <hilti/ast/ctors/tuple.h>
 #include <hilti/ast/declaration.h>
@@ -443,6 +444,16 @@ struct VisitorPass2 : public visitor::MutatingPostOrder {
         replaceNode(n, x);
     }
 
+    void operator()(operator_::sink::SetBufferLimit* n) final {
+        hilti::Expressions args = {argument(n->op2(), 0)};
+
+        if ( auto* policy = argument(n->op2(), 1, nullptr) )
+            args.push_back(policy);
+
+        auto* x = builder()->memberCall(n->op0(), "set_buffer_limit", args);
+        replaceNode(n, x);
+    }
+
     void operator()(operator_::sink::SetInitialSequenceNumber* n) final {
         auto* x = builder()->memberCall(n->op0(), "set_initial_sequence_number", {argument(n->op2(), 0)});
         replaceNode(n, x);
@@ -816,6 +827,20 @@ Expression* CodeGen::addGlobalConstant(Ctor* ctor) {
     });
 }
 
+Expression* CodeGen::addGlobalSearcher(hilti::ctor::Bytes* ctor) {
+    auto& [uniquer, cache] = _global_constants["searcher"];
+
+    // We declare the searcher as a constant, so that it's computed just once
+    // per process when the C++ code initializes, and shared by all threads.
+    return cache.getOrCreate(ctor->print(), [&, &uniquer = uniquer]() {
+        auto id = uniquer.get(ID(HILTI_INTERNAL_ID("searcher")));
+        auto* init = builder()->call("spicy_rt::createSearcher", {builder()->bytes(ctor->value())});
+        auto* d = builder()->constant(id, init);
+        _hilti_module->add(context(), d);
+        return builder()->id(id);
+    });
+}
+
 hilti::declaration::Module* CodeGen::hiltiModule() const {
     if ( ! _hilti_module )
         hilti::logger().internalError("not compiling a HILTI unit");
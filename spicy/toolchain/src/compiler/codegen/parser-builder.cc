@@ -7,6 +7,7 @@
 #include <utility>
 
 #include <hilti/ast/builder/all.h>
+#include <hilti/ast/ctors/bytes.h>
 #include <hilti/ast/ctors/regexp.h>
 #include <hilti/ast/declarations/field.h>
 #include <hilti/ast/declarations/local-variable.h>
@@ -15,7 +16,9 @@
 #include <hilti/ast/expressions/name.h>
 #include <hilti/ast/expressions/type-wrapped.h>
 #include <hilti/ast/expressions/void.h>
+#include <hilti/ast/statements/block.h>
 #include <hilti/ast/statements/declaration.h>
+#include <hilti/ast/statements/if.h>
 #include <hilti/ast/types/bitfield.h>
 #include <hilti/ast/types/exception.h>
 #include <hilti/ast/types/integer.h>
@@ -1144,6 +1147,9 @@ struct ProductionVisitor : public production::Visitor {
             return p->type()->type()->template isA<hilti::type::RegExp>();
         });
 
+        // Joint regular expression for all regexp tokens, set by `parse()`.
+        Expression* joint_regexp = nullptr;
+
         auto parse = [&]() {
             bool first_token = true;
 
@@ -1198,6 +1204,7 @@ struct ProductionVisitor : public production::Visitor {
                     builder()->ctorRegExp(std::move(flattened),
                                           builder()->attributeSet(
                                               {builder()->attribute(hilti::attribute::kind::Nosub)})));
+                joint_regexp = re;
                 // Create the token matcher state.
                 builder()->addLocal(ID("ncur"), state().cur);
                 auto* ms = builder()->local("ms", builder()->memberCall(re, "token_matcher"));
@@ -1315,9 +1322,15 @@ struct ProductionVisitor : public production::Visitor {
                 pushBuilder(builder()->addWhile(builder()->bool_(true)), [&]() {
                     parse();
 
+                    // If all tokens are regexps, we can skip directly to
+                    // positions where one of them may start.
+                    Expression* prefilter = nullptr;
+                    if ( std::ranges::none_of(other, [](const auto& p) { return p->isLiteral(); }) )
+                        prefilter = joint_regexp;
+
                     auto [if_, else_] = builder()->addIfElse(builder()->or_(pb->atEod(), state().lahead));
                     pushBuilder(std::move(if_), [&]() { builder()->addBreak(); });
-                    pushBuilder(std::move(else_), [&]() { pb->advanceToNextData(); });
+                    pushBuilder(std::move(else_), [&]() { pb->advanceToNextData(prefilter); });
                 });
 
                 break;
@@ -1565,33 +1578,59 @@ struct ProductionVisitor : public production::Visitor {
             pb->afterHook();
         });
 
-        auto [body, try_] = builder()->addTry();
+        // Parse the remaining fields inside a loop that executes just once,
+        // so that parse errors raised directly in there can leave it without
+        // throwing; see `ParserBuilder::pushRecoveryScope()`.
+        auto* failure = builder()->addTmp("trial_failure", recoverableFailureType());
+        auto once = builder()->addWhile(builder()->bool_(true));
+        auto [body, try_] = once->addTry();
         pushBuilder(try_.addCatch(builder()->parameter(ID("e"), builder()->typeName("hilti::RecoverableFailure"))),
                     [&]() {
                         pushBuilder(builder()->addIf(
                                         builder()->or_(builder()->not_(is_trial_mode), builder()->not_(state().error))),
                                     [&]() { builder()->addRethrow(); });
 
-                        builder()->addDebugMsg("spicy",
-                                               "parse error during trial mode, resynchronizing: %s",
-                                               {builder()->id("e")});
+                        builder()->addAssign(failure, builder()->id("e"));
+                    });
 
-                        // Advance input so we can find the next synchronization point.
-                        pb->advanceToNextData();
+        once->addBreak();
 
-                        builder()->addContinue();
-                    });
+        pushBuilder(builder()->addIf(failure), [&]() {
+            pushBuilder(builder()->addIf(
+                            builder()->or_(builder()->not_(is_trial_mode), builder()->not_(state().error))),
+                        [&]() { pb->parseError("%s", builder()->deref(failure)); });
+
+            builder()->addDebugMsg("spicy",
+                                   "parse error during trial mode, resynchronizing: %s",
+                                   {builder()->deref(failure)});
 
+            // Advance input so we can find the next synchronization point.
+            pb->advanceToNextData();
+
+            builder()->addContinue();
+        });
+
+        builder()->addBreak();
+
+        pb->pushRecoveryScope(body->block(), failure);
         pushBuilder(std::move(body));
     }
 
     /** End sync and trial mode. */
     void finishSynchronize() {
-        builder()->addBreak();
+        pb->popRecoveryScope();
         popBuilder(); // body.
         popBuilder(); // while_.
     }
 
+    // Returns the type of variables recording a failure inside a recovery scope.
+    QualifiedType* recoverableFailureType() {
+        return builder()->qualifiedType(builder()->typeOptional(
+                                            builder()->qualifiedType(builder()->typeName("hilti::RecoverableFailure"),
+                                                                     hilti::Constness::Mutable)),
+                                        hilti::Constness::Mutable);
+    }
+
     std::pair<Expression*, Expression*> preAggregate(const Production* /*p*/, AttributeSet* attributes) {
         Expression* length = nullptr;
         builder()->addCall("hilti::debugIndent", {builder()->stringLiteral("spicy")});
@@ -1787,6 +1826,93 @@ struct ProductionVisitor : public production::Visitor {
             popBuilder();
     }
 
+    // Returns the number of bytes a field production consumes if it's a plain
+    // fixed-size integer field that can be parsed as part of a batch of such
+    // fields; returns zero otherwise.
+    uint64_t batchableFieldSize(const Production& p) {
+        auto* field = p.meta().field();
+        if ( ! field || ! p.meta().isFieldProduction() || ! p.isA<production::Variable>() )
+            return 0;
+
+        if ( p.meta().container() || field->isContainer() || field->isForwarding() || field->condition() )
+            return 0;
+
+        // Waiting for the whole batch upfront would change when the field's
+        // hooks execute, and a missing-input error would no longer reach its
+        // `%error` hook. Named fields may receive hooks externally, so this
+        // leaves anonymous fields without any hooks attached.
+        if ( field->emitHook() )
+            return 0;
+
+        // Anything beyond the byte order may change how much input the field
+        // consumes or where it's taken from, or run code after parsing it.
+        // For the latter, `&requires` could then fail only after we have
+        // already insisted on input for later fields, and `&convert` may have
+        // side effects that later fields would observe too late.
+        for ( const auto* a : field->attributes()->attributes() ) {
+            if ( a->kind() != attribute::kind::ByteOrder )
+                return 0;
+        }
+
+        auto* t = field->parseType()->type();
+
+        if ( auto* i = t->tryAs<hilti::type::UnsignedInteger>() )
+            return i->width() / 8;
+
+        if ( auto* i = t->tryAs<hilti::type::SignedInteger>() )
+            return i->width() / 8;
+
+        return 0;
+    }
+
+    // Parses a sequence of a unit's fields. Maximal runs of adjacent
+    // fixed-size fields (see `batchableFieldSize()`) are preceded by a
+    // single wait for the whole run's input, after which the fields are
+    // parsed without waiting for input individually.
+    template<typename Func>
+    void parseFieldsBatched(const production::Unit* p, const std::vector<uint64_t>& fields, Func&& parse_field) {
+        // `%skip` consumes a variable amount of input between fields.
+        const bool can_batch = state().literal_mode == LiteralMode::Default && ! state().input_prefetched &&
+                               ! p->unitType()->propertyItem("%skip");
+
+        for ( size_t i = 0; i < fields.size(); ) {
+            uint64_t total = 0;
+            auto j = i;
+
+            if ( can_batch ) {
+                for ( ; j < fields.size(); ++j ) {
+                    auto size = batchableFieldSize(*p->fields()[fields[j]]);
+                    if ( ! size )
+                        break;
+
+                    total += size;
+                }
+            }
+
+            if ( j - i < 2 ) {
+                // Not worth batching.
+                parse_field(p->fields()[fields[i]]);
+                ++i;
+                continue;
+            }
+
+            pb->waitForInput(builder()->integer(total),
+                             fmt("expecting %" PRIu64 " bytes for unpacking values", total),
+                             p->fields()[fields[i]]->meta().field()->meta());
+
+            auto pstate = state();
+            pstate.input_prefetched = true;
+            pushState(std::move(pstate));
+
+            for ( auto k = i; k < j; ++k )
+                parse_field(p->fields()[fields[k]]);
+
+            popState();
+
+            i = j;
+        }
+    }
+
     void operator()(const production::Unit* p) final {
         auto pstate = pb->state();
         pstate.self = destination();
@@ -1877,29 +2003,39 @@ struct ProductionVisitor : public production::Visitor {
             auto maybe_try = std::optional<decltype(std::declval<Builder>().addTry())>();
 
             if ( ! sync_point )
-                for ( auto field : fields )
-                    parse_field(p->fields()[field]);
+                parseFieldsBatched(p, fields, parse_field);
 
             else {
-                auto try_ = builder()->addTry();
-
+                // Parse the fields inside a loop that executes just once, so
+                // that parse errors raised directly in there can leave it
+                // without throwing; see `ParserBuilder::pushRecoveryScope()`.
+                auto* failure = builder()->addTmp("failure", recoverableFailureType());
+                auto once = builder()->addWhile(builder()->bool_(true));
+                auto try_ = once->addTry();
+
+                pb->pushRecoveryScope(try_.first->block(), failure);
                 pushBuilder(try_.first, [&]() {
                     for ( auto field : fields )
                         parse_field(p->fields()[field]);
                 });
+                pb->popRecoveryScope();
 
                 pushBuilder(try_.second.addCatch(
                                 builder()->parameter(ID("e"), builder()->typeName("hilti::RecoverableFailure"))),
-                            [&]() {
-                                // There is a sync point; run its production w/o consuming input until parsing
-                                // succeeds or we run out of data.
-                                builder()->addDebugMsg("spicy-verbose",
-                                                       fmt("failed to parse, will try to synchronize at '%s'",
-                                                           p->fields()[*sync_point]->meta().field()->id()));
-
-                                // Remember the original error so we can report it in case the sync failed.
-                                builder()->addAssign(state().error, builder()->id("e"));
-                            });
+                            [&]() { builder()->addAssign(failure, builder()->id("e")); });
+
+                once->addBreak();
+
+                pushBuilder(builder()->addIf(failure), [&]() {
+                    // There is a sync point; run its production w/o consuming input until parsing
+                    // succeeds or we run out of data.
+                    builder()->addDebugMsg("spicy-verbose",
+                                           fmt("failed to parse, will try to synchronize at '%s'",
+                                               p->fields()[*sync_point]->meta().field()->id()));
+
+                    // Remember the original error so we can report it in case the sync failed.
+                    builder()->addAssign(state().error, builder()->deref(failure));
+                });
 
                 startSynchronize(*p->fields()[*sync_point]);
                 ++trial_loops;
@@ -2052,8 +2188,9 @@ struct ProductionVisitor : public production::Visitor {
             }
 
             else if ( until_attr ) {
+                auto* until_value = pb->evaluateAttributeExpression(until_attr, "until");
                 Expression* until_expr =
-                    builder()->coerceTo(pb->evaluateAttributeExpression(until_attr, "until"),
+                    builder()->coerceTo(until_value,
                                         builder()->qualifiedType(builder()->typeBytes(), hilti::Constness::Const));
                 auto* until_bytes_var = builder()->addTmp("until_bytes", until_expr);
                 auto* until_bytes_size_var = builder()->addTmp("until_bytes_sz", builder()->size(until_bytes_var));
@@ -2064,7 +2201,7 @@ struct ProductionVisitor : public production::Visitor {
                                      "end-of-data reached before &until expression found",
                                      until_expr->meta());
 
-                    auto* find = builder()->memberCall(state().cur, "find", {until_bytes_var});
+                    auto* find = pb->findDelimiter(until_value, until_bytes_var);
                     auto found_id = ID("found");
                     auto it_id = ID("it");
                     auto* found = builder()->id(found_id);
@@ -2235,11 +2372,20 @@ std::shared_ptr<Builder> ParserBuilder::pushBuilder() {
 void ParserBuilder::addParserMethods(hilti::type::Struct* s, type::Unit* t, bool declare_only) {
     auto [id_ext_overload1, id_ext_overload2, id_ext_overload3, id_ext_context_new] = parseMethodIDs(*t);
 
+    // Parsing fully buffered input cannot suspend, so let the `parse1` and
+    // `parse3` entry points bypass the fiber if their input is frozen.
+    auto no_fiber_if_frozen = [&]() {
+        return builder()->attributeSet({builder()->attribute(hilti::attribute::kind::NoFiberIfFrozen)});
+    };
+
     hilti::declaration::Parameters params =
-        {builder()->parameter(HILTI_INTERNAL_ID("data"),
-                              builder()->typeValueReference(
-                                  builder()->qualifiedType(builder()->typeStream(), hilti::Constness::Mutable)),
-                              hilti::parameter::Kind::InOut),
+        {builder()->declarationParameter(HILTI_INTERNAL_ID("data"),
+                                         builder()->typeValueReference(
+                                             builder()->qualifiedType(builder()->typeStream(),
+                                                                      hilti::Constness::Mutable)),
+                                         hilti::parameter::Kind::InOut,
+                                         nullptr,
+                                         no_fiber_if_frozen()),
          builder()->parameter(HILTI_INTERNAL_ID("cur"),
                               builder()->typeOptional(
                                   builder()->qualifiedType(builder()->typeStreamView(), hilti::Constness::Mutable)),
@@ -2303,11 +2449,13 @@ void ParserBuilder::addParserMethods(hilti::type::Struct* s, type::Unit* t, bool
                                                  builder()->qualifiedType(builder()->typeName("spicy_rt::ParsedUnit"),
                                                                           hilti::Constness::Mutable)),
                                              hilti::parameter::Kind::InOut),
-                        builder()->parameter(HILTI_INTERNAL_ID("data"),
-                                             builder()->typeValueReference(
-                                                 builder()->qualifiedType(builder()->typeStream(),
-                                                                          hilti::Constness::Mutable)),
-                                             hilti::parameter::Kind::InOut),
+                        builder()->declarationParameter(HILTI_INTERNAL_ID("data"),
+                                                        builder()->typeValueReference(
+                                                            builder()->qualifiedType(builder()->typeStream(),
+                                                                                     hilti::Constness::Mutable)),
+                                                        hilti::parameter::Kind::InOut,
+                                                        nullptr,
+                                                        no_fiber_if_frozen()),
                         builder()->parameter(HILTI_INTERNAL_ID("cur"),
                                              builder()->typeOptional(
                                                  builder()->qualifiedType(builder()->typeStreamView(),
@@ -2927,6 +3075,21 @@ void ParserBuilder::waitForInput(std::string_view error_msg, const Meta& locatio
                         currentFilters(state())});
 }
 
+void ParserBuilder::expectBytesLiteral(Expression* literal, const Meta& location) {
+    auto args = Expressions{state().data,
+                            state().cur,
+                            literal,
+                            builder()->expression(location),
+                            currentFilters(state())};
+
+    if ( auto* failure = _recoveryFailure() ) {
+        builder()->addAssign(failure, builder()->call("spicy_rt::checkBytesLiteral", args));
+        builder()->addIf(failure)->addBreak();
+    }
+    else
+        builder()->addCall("spicy_rt::expectBytesLiteral", args);
+}
+
 Expression* ParserBuilder::waitForInputOrEod(Expression* min) {
     return builder()->call("spicy_rt::waitForInputOrEod", {state().data, state().cur, min, currentFilters(state())});
 }
@@ -2946,6 +3109,16 @@ void ParserBuilder::waitForEod() {
 }
 
 void ParserBuilder::parseError(Expression* error_msg, const Meta& meta) {
+    if ( auto* failure = _recoveryFailure() ) {
+        // Hand the error directly to the surrounding recovery code, which
+        // saves us from unwinding the stack.
+        builder()->addAssign(failure,
+                             builder()->exception(builder()->typeName("hilti::RecoverableFailure"), error_msg, meta),
+                             meta);
+        builder()->addBreak(meta);
+        return;
+    }
+
     builder()->addThrow(builder()->exception(builder()->typeName("spicy_rt::ParseError"), error_msg, meta), meta);
 }
 
@@ -2978,7 +3151,7 @@ void ParserBuilder::skip(Expression* size, const Meta& location) {
     });
 }
 
-void ParserBuilder::advanceToNextData() {
+void ParserBuilder::advanceToNextData(Expression* prefilter) {
     auto* old_offset = builder()->addTmp("old_offset", builder()->memberCall(state().cur, "offset"));
 
     auto* profiler =
@@ -2987,15 +3160,21 @@ void ParserBuilder::advanceToNextData() {
 
     builder()->addAssign(state().cur, builder()->memberCall(state().cur, "advance_to_next_data"));
 
+    Expression* sync_advance_block_size = nullptr;
+    if ( auto* p = state().unit->propertyItem("%sync-advance-block-size"); p && p->expression() )
+        sync_advance_block_size = p->expression();
+    else
+        sync_advance_block_size = builder()->integer(4096); // 4KB default
+
+    if ( prefilter )
+        // Don't skip across block boundaries so that `%sync_advance` still sees each block.
+        builder()->addAssign(state().cur,
+                             builder()->call("spicy_rt::skipToRegExpCandidate",
+                                             {state().cur, prefilter, sync_advance_block_size}));
+
     auto* new_offset = builder()->memberCall(state().cur, "offset");
 
     {
-        Expression* sync_advance_block_size = nullptr;
-        if ( auto* p = state().unit->propertyItem("%sync-advance-block-size"); p && p->expression() )
-            sync_advance_block_size = p->expression();
-        else
-            sync_advance_block_size = builder()->integer(4096); // 4KB default
-
         auto* old_block = builder()->division(old_offset, sync_advance_block_size);
         auto* new_block = builder()->division(new_offset, sync_advance_block_size);
         auto run_hook = builder()->addIf(builder()->unequal(old_block, new_block));
@@ -3148,6 +3327,27 @@ std::shared_ptr<Builder> ParserBuilder::_featureCodeIf(const type::Unit* unit,
     return builder()->addIf(cond);
 }
 
+Expression* ParserBuilder::_recoveryFailure() const {
+    if ( _recovery_scopes.empty() )
+        return nullptr;
+
+    const auto& scope = _recovery_scopes.back();
+
+    // A `break` leaves the scope only if there's nothing in between that
+    // captures it (loops, switches) or that would have caught the exception
+    // first (`try`). Blocks not yet linked into the function's AST end the
+    // search as well.
+    for ( hilti::Node* n = builder()->block(); n; n = n->parent() ) {
+        if ( n == scope.block )
+            return scope.failure;
+
+        if ( ! (n->isA<hilti::statement::Block>() || n->isA<hilti::statement::If>()) )
+            return nullptr;
+    }
+
+    return nullptr;
+}
+
 QualifiedType* ParserBuilder::lookAheadType() const {
     return builder()->qualifiedType(builder()->typeSignedInteger(64), hilti::Constness::Mutable);
 }
@@ -3157,6 +3357,15 @@ hilti::Expression* ParserBuilder::featureConstant(const type::Unit* unit, std::s
     return builder()->id(ID(hilti::rt::fmt("::%s%%%s%%%s", HILTI_INTERNAL_ID("feat"), id, feature)));
 }
 
+Expression* ParserBuilder::findDelimiter(Expression* delimiter, Expression* value) {
+    if ( auto* ctor = delimiter->tryAs<hilti::expression::Ctor>() ) {
+        if ( auto* bytes = ctor->ctor()->tryAs<hilti::ctor::Bytes>() )
+            return builder()->call("spicy_rt::findLiteral", {state().cur, cg()->addGlobalSearcher(bytes)});
+    }
+
+    return builder()->memberCall(state().cur, "find", {value});
+}
+
 Expression* ParserBuilder::evaluateAttributeExpression(const hilti::Attribute* attr, const std::string& prefix) {
     Expression* attr_expr = *attr->valueAsExpression();
 
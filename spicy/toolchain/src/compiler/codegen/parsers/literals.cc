@@ -109,14 +109,7 @@ struct Visitor : public visitor::PreOrder {
                     pushBuilder(std::move(no_lah));
                 }
 
-                auto* expect_bytes_literal = builder()->call("spicy_rt::expectBytesLiteral",
-                                                             {state().data,
-                                                              state().cur,
-                                                              literal,
-                                                              builder()->expression(n->meta()),
-                                                              pb()->currentFilters(state())});
-
-                builder()->addExpression(expect_bytes_literal);
+                pb()->expectBytesLiteral(literal, n->meta());
 
                 if ( state().literal_mode != LiteralMode::Skip )
                     builder()->addAssign(lp->destination(n->type()->type()), literal);
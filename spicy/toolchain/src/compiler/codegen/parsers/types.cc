@@ -62,8 +62,10 @@ struct TypeParser {
         auto* qt = builder()->qualifiedType(t, hilti::Constness::Mutable);
 
         if ( ! is_try ) {
-            auto error_msg = fmt("expecting %d bytes for unpacking value", len);
-            pb->waitForInput(builder()->integer(len), error_msg, m);
+            if ( ! state().input_prefetched ) {
+                auto error_msg = fmt("expecting %d bytes for unpacking value", len);
+                pb->waitForInput(builder()->integer(len), error_msg, m);
+            }
 
             auto* unpacked = builder()->unpack(qt, unpack_args);
             builder()->addAssign(builder()->tuple({target, state().cur}), builder()->deref(unpacked));
@@ -370,15 +372,15 @@ struct Visitor : public visitor::PreOrder {
                 }
 
                 if ( until_attr || until_including_attr ) {
-                    Expression* until_expr = nullptr;
+                    Expression* until_value = nullptr;
                     if ( until_attr )
-                        until_expr = builder()->coerceTo(*until_attr->valueAsExpression(),
-                                                         builder()->qualifiedType(builder()->typeBytes(),
-                                                                                  hilti::Constness::Mutable));
+                        until_value = *until_attr->valueAsExpression();
                     else
-                        until_expr = builder()->coerceTo(*until_including_attr->valueAsExpression(),
-                                                         builder()->qualifiedType(builder()->typeBytes(),
-                                                                                  hilti::Constness::Mutable));
+                        until_value = *until_including_attr->valueAsExpression();
+
+                    Expression* until_expr =
+                        builder()->coerceTo(until_value,
+                                            builder()->qualifiedType(builder()->typeBytes(), hilti::Constness::Mutable));
 
                     auto* until_bytes_var = builder()->addTmp("until_bytes", until_expr);
                     auto* until_bytes_size_var = builder()->addTmp("until_bytes_sz", builder()->size(until_bytes_var));
@@ -408,7 +410,7 @@ struct Visitor : public visitor::PreOrder {
                                                (until_attr ? "&until" : "&until-including")),
                                            until_expr->meta());
 
-                        auto* find = builder()->memberCall(state().cur, "find", {until_bytes_var});
+                        auto* find = pb()->findDelimiter(until_value, until_bytes_var);
                         auto found_id = ID("found");
                         auto it_id = ID("it");
                         auto* found = builder()->id(found_id);